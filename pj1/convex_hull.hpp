@@ -0,0 +1,567 @@
+#ifndef VE281P1_CONVEX_HULL_HPP
+#define VE281P1_CONVEX_HULL_HPP
+
+#include "orientation.hpp"
+#include "parallel_sort.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
+/**
+ * Convex hulls of integer points. Every algorithm here returns the hull in
+ * the same form: counter-clockwise from p0 (lowest y, then lowest x),
+ * without collinear points.
+ * graham_hull, chan_hull and parallel_hull work on a whole point set;
+ * DynamicHull keeps the hull of a stream of points up to date.
+ */
+
+//move p0 (lowest y, then lowest x) to the front
+inline void find_p0(std::vector<point> &all){
+    long int index=0;
+    for (long int i=0; i<(long int)all.size(); i++){
+        if (all[i].y<all[index].y)
+            index=i;
+        else if (all[i].y==all[index].y){
+            if (all[i].x<all[index].x)
+                index=i;
+        }
+        else{}
+    }
+    std::swap(all[index], all[0]);
+}
+
+//sign of the turn p1 -> p2 -> p3, exact (see orientation.hpp)
+inline int ccw(const point &p1, const point &p2, const point &p3){
+    return orientation(p1, p2, p3);
+}
+
+inline bool compare_p(const point &p0, const point &p1, const point &p2){
+    int turn=ccw(p0, p1, p2);
+    if (turn>0)
+        return 1;
+    //equal points are not less than each other, or std::sort may run off the end on duplicates
+    if (turn==0){
+        if (p1.x!=p2.x || p1.y!= p2.y){
+            if (std::abs(p1.x-p0.x)<std::abs(p2.x-p0.x) || std::abs(p1.y-p0.y)<std::abs(p2.y-p0.y))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+//polar keys closer than this may be ordered wrongly by rounding and are compared exactly
+const double POLAR_KEY_TOLERANCE=1e-12;
+
+/**
+ * Polar key of q around p0. Every point is above p0 or to its right on
+ * the same line, and there -dx/(|dx|+dy) grows strictly with the angle;
+ * p0 and its duplicates get -2, in front of everything.
+ */
+inline double polar_key(const point &p0, const point &q){
+    double dx=(double)(q.x-p0.x), dy=(double)(q.y-p0.y);
+    return dx==0 && dy==0 ? -2 : -dx/(std::fabs(dx)+dy);
+}
+
+/**
+ * Sort all[1..] by angle around p0=all[0], nearer first on the same ray.
+ * The points are sorted by their polar keys, computed once per point
+ * (radix sorted by sort_by_key), and only runs of keys that rounding
+ * could have misordered are sorted again with the exact compare_p.
+ */
+inline void polar_sort(std::vector<point> &all){
+    point p0=all[0];
+    sort_by_key(all, [p0](const point &q){ return polar_key(p0, q); });
+    long int n=(long int)all.size();
+    double prev=polar_key(p0, all[0]);
+    for (long int i=1, run=0; i<=n; i++){
+        double key=i<n ? polar_key(p0, all[i]) : 0;
+        if (i<n && key-prev<=POLAR_KEY_TOLERANCE){
+            prev=key;
+            continue;
+        }
+        if (i-run>1)
+            std::sort(all.begin()+run, all.begin()+i,
+                [&p0](const point &a, const point &b){ return compare_p(p0, a, b); });
+        run=i;
+        prev=key;
+    }
+}
+
+/**
+ * Remove every point that is collinear with p0 and the next point kept,
+ * so of each ray from p0 only the farthest point stays, and a duplicate
+ * of p0 replaces it. The survivors are compacted towards the back in
+ * one pass and then moved down behind p0.
+ * Time complexity: O(n)
+ */
+inline void erase_same(std::vector<point> &all){
+    long int n=(long int)all.size();
+    if (n<2)
+        return ;
+    long int kept=n-1;
+    for (long int i=n-2; i>=1; i--){
+        if (ccw(all[0], all[kept], all[i])!=0)
+            all[--kept]=all[i];
+    }
+    std::move(all.begin()+kept, all.end(), all.begin()+1);
+    all.resize(1+n-kept);
+    if (all.size()>1 && all[0].x==all[1].x && all[0].y==all[1].y)
+        all.erase(all.begin());
+}
+
+//extreme points of [first, last) in the eight octagon directions, counter-clockwise from the bottom
+inline void octagon_corners(const point *first, const point *last, point corner[8]){
+    //bottom, bottom right, right, top right, top, top left, left, bottom left
+    for (int c=0; c<8; c++)
+        corner[c]=*first;
+    for (const point *it=first; it<last; it++){
+        if (it->y<corner[0].y)
+            corner[0]=*it;
+        if (it->x-it->y>corner[1].x-corner[1].y)
+            corner[1]=*it;
+        if (it->x>corner[2].x)
+            corner[2]=*it;
+        if (it->x+it->y>corner[3].x+corner[3].y)
+            corner[3]=*it;
+        if (it->y>corner[4].y)
+            corner[4]=*it;
+        if (it->y-it->x>corner[5].y-corner[5].x)
+            corner[5]=*it;
+        if (it->x<corner[6].x)
+            corner[6]=*it;
+        if (it->x+it->y<corner[7].x+corner[7].y)
+            corner[7]=*it;
+    }
+}
+
+//the octagon through the corners without repeated vertices, return its number of vertices
+inline int octagon_of(const point corner[8], point octagon[8]){
+    int k=0;
+    for (int c=0; c<8; c++)
+        if (k==0 || corner[c].x!=octagon[k-1].x || corner[c].y!=octagon[k-1].y)
+            octagon[k++]=corner[c];
+    while (k>1 && octagon[k-1].x==octagon[0].x && octagon[k-1].y==octagon[0].y)
+        k--;
+    return k;
+}
+
+/**
+ * Compact [first, first+n) to the points that are not strictly inside
+ * the convex polygon, classifying a chunk at a time against every edge
+ * @return number of points kept
+ */
+inline long int keep_outside(point *first, long int n, const point *polygon, int k){
+    int8_t sign[ORIENTATION_BATCH];
+    bool inside[ORIENTATION_BATCH];
+    long int kept=0;
+    for (long int begin=0; begin<n; begin+=ORIENTATION_BATCH){
+        long int size=n-begin<ORIENTATION_BATCH ? n-begin : ORIENTATION_BATCH;
+        for (long int i=0; i<size; i++)
+            inside[i]=true;
+        for (int e=0; e<k; e++){
+            orientation_batch(polygon[e], polygon[(e+1)%k], first+begin, size, sign);
+            for (long int i=0; i<size; i++)
+                inside[i]&=sign[i]>0;
+        }
+        for (long int i=0; i<size; i++)
+            if (!inside[i])
+                first[kept++]=first[begin+i];
+    }
+    return kept;
+}
+
+/**
+ * Akl-Toussaint heuristic: drop the points strictly inside the octagon
+ * of the extreme points in x, y, x+y and x-y. None of them can be a hull
+ * vertex, and on uniformly spread points they are nearly all of them.
+ * Time complexity: O(n)
+ */
+inline void octagon_filter(std::vector<point> &all){
+    if (all.size()<9)
+        return ;
+    point corner[8], octagon[8];
+    octagon_corners(all.data(), all.data()+all.size(), corner);
+    int k=octagon_of(corner, octagon);
+    if (k<3)
+        return ;
+    all.resize(keep_outside(all.data(), (long int)all.size(), octagon, k));
+}
+
+/**
+ * Same on the threads of pool: every thread finds the corners of its
+ * block and, once the octagon is known, compacts its block in place.
+ */
+inline void octagon_filter(std::vector<point> &all, ThreadPool &pool){
+    long int n=(long int)all.size();
+    if (n<9)
+        return ;
+    unsigned int threads=pool.size()+1;
+    std::vector<point> candidates(8*threads);
+    run_threads(pool, threads, [&](unsigned int t){
+        long int begin=n*t/threads, end=n*(t+1)/threads;
+        octagon_corners(all.data()+(begin<end ? begin : 0), all.data()+end, &candidates[8*t]);
+    });
+    point corner[8], octagon[8];
+    octagon_corners(candidates.data(), candidates.data()+candidates.size(), corner);
+    int k=octagon_of(corner, octagon);
+    if (k<3)
+        return ;
+    std::vector<long int> kept(threads);
+    run_threads(pool, threads, [&](unsigned int t){
+        long int begin=n*t/threads, end=n*(t+1)/threads;
+        kept[t]=keep_outside(all.data()+begin, end-begin, octagon, k);
+    });
+    long int size=kept[0];
+    for (unsigned int t=1; t<threads; t++){
+        auto begin=all.begin()+n*t/threads;
+        std::move(begin, begin+kept[t], all.begin()+size);
+        size+=kept[t];
+    }
+    all.resize(size);
+}
+
+inline void scan(std::vector<point> &all, std::vector<point> &hull){
+    for (auto it:all){
+        while(hull.size()>1 && ccw(*(hull.end()-2), *(hull.end()-1), it)<=0){
+            hull.pop_back();
+        }
+        hull.push_back(it);
+    }
+}
+
+//the Graham scan: sort by angle around p0, keep the farthest point of every ray, then scan
+inline void graham_hull(std::vector<point> &all, std::vector<point> &hull){
+    find_p0(all);
+    polar_sort(all);
+    erase_same(all);
+    scan(all, hull);
+}
+
+/**
+ * Extend the chain out by the points of [first, last), popping every
+ * vertex that does not make a left turn: given the points in (x, y)
+ * order this builds the lower hull, given them backwards the upper one.
+ * Repeated points are skipped.
+ */
+template<typename It>
+void half_hull(It first, It last, std::vector<point> &out){
+    for (It it=first; it!=last; ++it){
+        if (!out.empty() && out.back().x==it->x && out.back().y==it->y)
+            continue;
+        while (out.size()>1 && ccw(*(out.end()-2), *(out.end()-1), *it)<=0)
+            out.pop_back();
+        out.push_back(*it);
+    }
+}
+
+//rotate a counter-clockwise hull so that it starts at p0 (lowest y, then lowest x)
+inline void rotate_to_p0(std::vector<point> &hull){
+    long int index=0;
+    for (long int i=1; i<(long int)hull.size(); i++)
+        if (hull[i].y<hull[index].y || (hull[i].y==hull[index].y && hull[i].x<hull[index].x))
+            index=i;
+    std::rotate(hull.begin(), hull.begin()+index, hull.end());
+}
+
+/**
+ * Monotone chain convex hull on the threads of pool. The points are
+ * sorted by (x, y) with the parallel sample sort and cut into one slab
+ * per thread; each thread builds the lower and upper hull of its slab,
+ * and since a point off its slab's hull is off the whole hull, chaining
+ * the slab hulls once more gives the hull of all points.
+ * Time complexity: O(n log n / threads + h threads)
+ */
+inline void parallel_hull(std::vector<point> &all, std::vector<point> &hull, ThreadPool &pool){
+    long int n=(long int)all.size();
+    parallel_sort(all, [](const point &a, const point &b){ return a.x<b.x || (a.x==b.x && a.y<b.y); }, pool);
+    unsigned int threads=pool.size()+1;
+    std::vector<std::vector<point>> lower(threads), upper(threads);
+    run_threads(pool, threads, [&](unsigned int t){
+        long int begin=n*t/threads, end=n*(t+1)/threads;
+        half_hull(all.begin()+begin, all.begin()+end, lower[t]);
+        half_hull(all.rbegin()+(n-end), all.rbegin()+(n-begin), upper[t]);
+    });
+
+    std::vector<point> lowerAll, upperAll, lowerHull, upperHull;
+    for (unsigned int t=0; t<threads; t++)
+        lowerAll.insert(lowerAll.end(), lower[t].begin(), lower[t].end());
+    for (unsigned int t=threads; t-->0; )
+        upperAll.insert(upperAll.end(), upper[t].begin(), upper[t].end());
+    half_hull(lowerAll.begin(), lowerAll.end(), lowerHull);
+    half_hull(upperAll.begin(), upperAll.end(), upperHull);
+
+    //both chains end where the other starts
+    hull.assign(lowerHull.begin(), lowerHull.end()-1);
+    hull.insert(hull.end(), upperHull.begin(), upperHull.end()-1);
+    if (hull.empty()){
+        hull=lowerHull;
+        return ;
+    }
+    rotate_to_p0(hull);
+}
+
+//first guess at the hull size in Chan's algorithm, squared after every guess that was too small;
+//groups this large still sort fast, and leave few enough group hulls that wrapping them is cheap
+const long int CHAN_FIRST_GUESS=16384;
+
+//whether a is farther from q than b, all three on one ray from q
+inline bool farther(const point &q, const point &a, const point &b){
+    return std::abs(a.x-q.x)>std::abs(b.x-q.x) || std::abs(a.y-q.y)>std::abs(b.y-q.y);
+}
+
+/**
+ * Move the pointer at on the convex polygon hull[0, k) forward to the
+ * vertex t that has the whole polygon left of or on q -> t, the farthest
+ * such vertex if there are several. Going round the hull counter-clockwise,
+ * this tangent only ever moves forward, so the pointer left by the previous
+ * hull vertex is where the walk for the next one starts.
+ * @return the new pointer
+ */
+inline long int advance_tangent(const point *hull, long int k, long int at, const point &q){
+    for (long int steps=1; steps<k; steps++){
+        long int next=at+1<k ? at+1 : 0;
+        int turn=ccw(q, hull[at], hull[next]);
+        if (turn>0 || (turn==0 && !farther(q, hull[next], hull[at])))
+            break;
+        at=next;
+    }
+    return at;
+}
+
+/**
+ * Jarvis march from p0 over the group hulls, group g being
+ * hulls[start[g], start[g+1]): every step takes the most clockwise of the
+ * groups' tangents, the farthest one on ties, until it is back at p0.
+ * @return false if that takes more than limit steps
+ */
+inline bool wrap_groups(const std::vector<point> &hulls, const std::vector<long int> &start, const point &p0,
+    long int limit, std::vector<point> &hull){
+    long int groups=(long int)start.size()-1;
+    std::vector<long int> at(groups, 0);
+    hull.assign(1, p0);
+    for (long int step=0; step<limit; step++){
+        point q=hull.back();
+        const point *best=nullptr;
+        for (long int g=0; g<groups; g++){
+            const point *group=hulls.data()+start[g];
+            at[g]=advance_tangent(group, start[g+1]-start[g], at[g], q);
+            const point &t=group[at[g]];
+            //a group may hold q itself or a duplicate of it
+            if (t.x==q.x && t.y==q.y)
+                continue;
+            if (best==nullptr){
+                best=&t;
+                continue;
+            }
+            int turn=ccw(q, *best, t);
+            if (turn<0 || (turn==0 && farther(q, t, *best)))
+                best=&t;
+        }
+        if (best==nullptr || (best->x==p0.x && best->y==p0.y))
+            return true;
+        hull.push_back(*best);
+    }
+    return false;
+}
+
+/**
+ * Chan's algorithm. For a guess m of the hull size, the points are cut
+ * into groups of m, the hull of every group is taken with the Graham scan
+ * and the group hulls are wrapped from p0; if that needs more than m steps
+ * the guess was too small and is squared. The first guess that is large
+ * enough is below max(h^2, CHAN_FIRST_GUESS), so the rounds add up to
+ * O(n log h).
+ * Time complexity: O(n log h)
+ */
+inline void chan_hull(std::vector<point> &all, std::vector<point> &hull){
+    long int n=(long int)all.size();
+    find_p0(all);
+    point p0=all[0];
+    std::vector<point> hulls, group, groupHull;
+    std::vector<long int> start;
+    for (long int m=std::min(CHAN_FIRST_GUESS, n); ; m=m<n/m ? m*m : n){
+        hulls.clear();
+        start.assign(1, 0);
+        for (long int begin=0; begin<n; begin+=m){
+            group.assign(all.begin()+begin, all.begin()+std::min(begin+m, n));
+            groupHull.clear();
+            graham_hull(group, groupHull);
+            hulls.insert(hulls.end(), groupHull.begin(), groupHull.end());
+            start.push_back((long int)hulls.size());
+        }
+        if (wrap_groups(hulls, start, p0, m, hull))
+            return ;
+    }
+}
+
+/**
+ * Lower hull of the points inserted so far, as a function of x: the
+ * lowest point at every x on it, in a balanced tree keyed by x. A point
+ * is located and spliced in with O(log n) tree operations and every
+ * vertex it makes redundant is erased once, so insertion is O(log n)
+ * amortized. A mirrored chain stores every point as (x, -y) and so keeps
+ * the upper hull.
+ */
+class HullChain {
+public:
+    explicit HullChain(bool mirrored) : mirror(mirrored ? -1 : 1) {}
+
+    //return false if q is on or above the chain and changes nothing
+    bool insert(const point &q) {
+        return insert_stored({q.x, mirror*q.y});
+    }
+
+    /**
+     * Add a batch sorted by (x, y). Its own chain is built first; if that
+     * is long next to the tree, the two chains are merged by x and rebuilt
+     * in one O(n) pass instead of being spliced in one by one.
+     */
+    void insert_sorted(const std::vector<point> &batch) {
+        std::vector<point> added;
+        for (auto &q: batch){
+            point s={q.x, mirror*q.y};
+            if (!added.empty() && added.back().x==s.x){
+                if (added.back().y<=s.y)
+                    continue;
+                added.pop_back();
+            }
+            push_convex(added, s);
+        }
+        long int n=(long int)chain.size();
+        if ((double)added.size()*std::log2((double)n+2)<(double)n){
+            for (auto &s: added)
+                insert_stored(s);
+            return ;
+        }
+        std::vector<point> merged;
+        merged.reserve(n+added.size());
+        auto it=chain.begin();
+        for (auto a=added.begin(); it!=chain.end() || a!=added.end(); ){
+            point s;
+            if (a==added.end() || (it!=chain.end() && it->first<a->x))
+                s=at(it++);
+            else if (it==chain.end() || a->x<it->first)
+                s=*a++;
+            else{
+                s=it->second<a->y ? at(it) : *a;
+                ++it;
+                ++a;
+            }
+            push_convex(merged, s);
+        }
+        chain.clear();
+        for (auto &s: merged)
+            chain.emplace_hint(chain.end(), s.x, s.y);
+    }
+
+    //append the vertices in increasing x
+    void append(std::vector<point> &out) const {
+        for (auto &v: chain)
+            out.push_back({v.first, mirror*v.second});
+    }
+
+    long int size() const { return (long int)chain.size(); }
+
+private:
+    typedef std::map<long int, long int>::iterator Iterator;
+
+    static point at(Iterator it) { return {it->first, it->second}; }
+
+    //append s to a chain with increasing x, popping the vertices it makes redundant
+    static void push_convex(std::vector<point> &out, const point &s) {
+        while (out.size()>1 && ccw(*(out.end()-2), out.back(), s)<=0)
+            out.pop_back();
+        out.push_back(s);
+    }
+
+    bool insert_stored(const point &s) {
+        Iterator it=chain.lower_bound(s.x);
+        bool same=it!=chain.end() && it->first==s.x;
+        if (same && it->second<=s.y)
+            return false;
+        //between two vertices, on or above the edge joining them
+        Iterator right=same ? std::next(it) : it;
+        if (it!=chain.begin() && right!=chain.end() && ccw(at(std::prev(it)), at(right), s)>=0)
+            return false;
+        if (same)
+            it->second=s.y;
+        else
+            it=chain.emplace_hint(it, s.x, s.y);
+        while (it!=chain.begin() && std::prev(it)!=chain.begin()){
+            Iterator b=std::prev(it);
+            if (ccw(at(std::prev(b)), at(b), s)>0)
+                break;
+            chain.erase(b);
+        }
+        while (std::next(it)!=chain.end() && std::next(it, 2)!=chain.end()){
+            Iterator b=std::next(it);
+            if (ccw(s, at(b), at(std::next(b)))>0)
+                break;
+            chain.erase(b);
+        }
+        return true;
+    }
+
+    std::map<long int, long int> chain;
+    long int mirror;
+};
+
+/**
+ * Convex hull of a stream of points, kept as its lower and upper chains.
+ * Points can be added one at a time or in batches, and hull() reads the
+ * current hull off the chains in O(h), without looking at any point
+ * again.
+ */
+class DynamicHull {
+public:
+    DynamicHull() : lower(false), upper(true) {}
+
+    //Time complexity: O(log n) amortized
+    void insert(const point &q) {
+        lower.insert(q);
+        upper.insert(q);
+    }
+
+    /**
+     * Add the points of [first, last)
+     * Time complexity: O(k log k + min(k' log h, h + k')) for k points of
+     * which k' are on their own hull
+     */
+    template<typename It>
+    void insert(It first, It last) {
+        std::vector<point> batch(first, last);
+        quick_sort_inplace(batch, [](const point &a, const point &b){ return a.x<b.x || (a.x==b.x && a.y<b.y); });
+        lower.insert_sorted(batch);
+        upper.insert_sorted(batch);
+    }
+
+    bool empty() const { return lower.size()==0; }
+
+    /**
+     * The current hull, counter-clockwise from p0 without collinear points
+     * Time complexity: O(h)
+     */
+    void hull(std::vector<point> &out) const {
+        out.clear();
+        if (empty())
+            return ;
+        std::vector<point> top;
+        lower.append(out);
+        upper.append(top);
+        //the upper chain shares its end points with the lower one unless the hull has a vertical side there
+        for (auto it=top.rbegin(); it!=top.rend(); ++it)
+            if ((it->x!=out.back().x || it->y!=out.back().y) && (it->x!=out.front().x || it->y!=out.front().y))
+                out.push_back(*it);
+        rotate_to_p0(out);
+    }
+
+private:
+    HullChain lower, upper;
+};
+
+#endif //VE281P1_CONVEX_HULL_HPP
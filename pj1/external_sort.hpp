@@ -0,0 +1,336 @@
+#ifndef VE281P1_EXTERNAL_SORT_HPP
+#define VE281P1_EXTERNAL_SORT_HPP
+
+#include "sort.hpp"
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//target size of one read or write while merging runs
+const long int EXTERNAL_BLOCK_BYTES=4<<20;
+//per-run blocks smaller than this make the merge seek-bound, so it is split into passes
+const long int EXTERNAL_MIN_BLOCK_BYTES=256<<10;
+
+/**
+ * An I/O job on its own thread. finish() joins it and rethrows whatever
+ * the job threw, so failures surface on the thread that drives the sort.
+ */
+class IoTask {
+public:
+    IoTask() : worker(), error() {}
+
+    IoTask(const IoTask &)=delete;
+    IoTask &operator=(const IoTask &)=delete;
+
+    ~IoTask() {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    template<typename Fn>
+    void start(Fn fn) {
+        finish();
+        worker=std::thread([this, fn]{
+            try {
+                fn();
+            }
+            catch (...) {
+                error=std::current_exception();
+            }
+        });
+    }
+
+    void finish() {
+        if (worker.joinable())
+            worker.join();
+        if (error){
+            std::exception_ptr e=error;
+            error=nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+private:
+    std::thread worker;
+    std::exception_ptr error;
+};
+
+/**
+ * A file descriptor that is closed when it goes out of scope.
+ * @throw std::runtime_error if the file cannot be opened
+ */
+class ExternalFile {
+public:
+    ExternalFile(const std::string &path, int flags) : fd(::open(path.c_str(), flags, 0644)) {
+        if (fd<0)
+            throw std::runtime_error("cannot open "+path);
+    }
+
+    ExternalFile(const ExternalFile &)=delete;
+    ExternalFile &operator=(const ExternalFile &)=delete;
+
+    ~ExternalFile() { ::close(fd); }
+
+    off_t size() const {
+        struct stat st;
+        if (fstat(fd, &st)<0)
+            throw std::runtime_error("cannot stat file");
+        return st.st_size;
+    }
+
+    /**
+     * Read up to bytes at offset, short only at the end of the file
+     * @return number of bytes read
+     */
+    long int read_at(void *data, long int bytes, off_t offset) const {
+        long int done=0;
+        while (done<bytes){
+            ssize_t got=::pread(fd, (char *)data+done, bytes-done, offset+done);
+            if (got<0 && errno==EINTR)
+                continue;
+            if (got<0)
+                throw std::runtime_error("read failed");
+            if (got==0)
+                break;
+            done+=got;
+        }
+        return done;
+    }
+
+    void write_at(const void *data, long int bytes, off_t offset) const {
+        long int done=0;
+        while (done<bytes){
+            ssize_t put=::pwrite(fd, (const char *)data+done, bytes-done, offset+done);
+            if (put<0 && errno==EINTR)
+                continue;
+            if (put<=0)
+                throw std::runtime_error("write failed");
+            done+=put;
+        }
+    }
+
+private:
+    int fd;
+};
+
+//a sorted run inside a file, both counted in records
+struct ExternalRun {
+    long int begin;
+    long int size;
+};
+
+/**
+ * Streams one run back in blocks, prefetching the next block on a
+ * background thread while the current one is being merged.
+ */
+template<typename T>
+class RunReader {
+public:
+    RunReader(const ExternalFile &file, ExternalRun run, long int block)
+        : file(file), next(run.begin), end(run.begin+run.size), block(block), pos(0), cur(0), size{0, 0} {
+        data[0].reset(new T[block]);
+        data[1].reset(new T[block]);
+        size[0]=fetch(data[0].get());
+        prefetch();
+    }
+
+    const T *head() const { return pos<size[cur] ? &data[cur][pos] : nullptr; }
+
+    void advance() {
+        if (++pos<size[cur])
+            return ;
+        task.finish();
+        cur^=1;
+        pos=0;
+        if (size[cur]>0)
+            prefetch();
+    }
+
+private:
+    const ExternalFile &file;
+    long int next, end, block, pos;
+    int cur;
+    long int size[2];
+    std::unique_ptr<T[]> data[2];
+    IoTask task;
+
+    long int fetch(T *into) {
+        long int count=end-next<block ? end-next : block;
+        if (count>0 && file.read_at(into, count*sizeof(T), (off_t)next*sizeof(T))!=(long int)(count*sizeof(T)))
+            throw std::runtime_error("run file is truncated");
+        next+=count;
+        return count;
+    }
+
+    void prefetch() {
+        T *into=data[cur^1].get();
+        long int *count=&size[cur^1];
+        task.start([this, into, count]{ *count=fetch(into); });
+    }
+};
+
+/**
+ * k-way merge of runs of from into out, starting at record offset at.
+ * Output blocks are double buffered: one is written in the background
+ * while the other is filled.
+ */
+template<typename T, typename Compare>
+void merge_external_runs(const ExternalFile &from, const std::vector<ExternalRun> &runs,
+    const ExternalFile &out, long int at, long int block, Compare comp){
+    long int k=(long int)runs.size();
+    std::vector<std::unique_ptr<RunReader<T>>> readers;
+    LoserTree<T, Compare> tree(k, comp);
+    for (long int i=0; i<k; i++){
+        readers.emplace_back(new RunReader<T>(from, runs[i], block));
+        tree.set(i, readers[i]->head());
+    }
+    tree.build();
+
+    std::unique_ptr<T[]> buffer[2]={std::unique_ptr<T[]>(new T[block]), std::unique_ptr<T[]>(new T[block])};
+    int cur=0;
+    long int filled=0;
+    IoTask writer;
+    for (long int r=tree.top(); r>=0; r=tree.top()){
+        buffer[cur][filled++]=tree.value();
+        readers[r]->advance();
+        tree.replace(readers[r]->head());
+        if (filled==block){
+            writer.finish();
+            const T *data=buffer[cur].get();
+            off_t offset=(off_t)at*sizeof(T);
+            writer.start([&out, data, offset, block]{ out.write_at(data, block*sizeof(T), offset); });
+            at+=block;
+            cur^=1;
+            filled=0;
+        }
+    }
+    writer.finish();
+    out.write_at(buffer[cur].get(), filled*sizeof(T), (off_t)at*sizeof(T));
+}
+
+/**
+ * Sort a binary file of fixed-size records that may be far larger than
+ * memory. Chunks of about memory/3 bytes are read, sorted with the
+ * in-memory introsort and written back as runs, with the read of the next
+ * chunk and the write of the previous one overlapping the sort. The runs
+ * are then merged through a loser tree with large double-buffered reads
+ * and writes; if there are too many runs for the memory budget to give
+ * each a reasonable block, the merge takes several passes.
+ * Runs live in an unlinked scratch file next to output (or at tmp).
+ * Not stable.
+ * Time complexity: O(n log n) comparisons, O(n log_k(n/memory)) I/O
+ * @throw std::runtime_error on I/O failure or if the input size is not a multiple of sizeof(T)
+ */
+template<typename T, typename Compare = std::less<T>>
+void external_sort(const std::string &input, const std::string &output, long int memory,
+    Compare comp = Compare(), const std::string &tmp = "") {
+    static_assert(std::is_trivially_copyable<T>::value, "external_sort needs fixed-size records");
+    long int total, chunk=memory/(3*(long int)sizeof(T));
+    if (chunk<1)
+        chunk=1;
+    std::vector<ExternalRun> runs;
+    std::string scratch_path=tmp.empty() ? output+".runs" : tmp;
+    std::unique_ptr<ExternalFile> scratch;
+    {
+        ExternalFile in(input, O_RDONLY);
+        off_t bytes=in.size();
+        if (bytes%sizeof(T))
+            throw std::runtime_error(input+" is not a whole number of records");
+        total=(long int)(bytes/sizeof(T));
+
+        if (total<=3*chunk){
+            //fits in memory: one sort, no runs
+            std::unique_ptr<T[]> data(new T[total>0 ? total : 1]);
+            in.read_at(data.get(), total*sizeof(T), 0);
+            quick_sort_inplace(data.get(), data.get()+total, comp);
+            ExternalFile out(output, O_WRONLY|O_CREAT|O_TRUNC);
+            out.write_at(data.get(), total*sizeof(T), 0);
+            return ;
+        }
+
+        scratch.reset(new ExternalFile(scratch_path, O_RDWR|O_CREAT|O_TRUNC));
+        ::unlink(scratch_path.c_str());
+
+        //three buffers rotate through read -> sort -> write
+        std::unique_ptr<T[]> data[3];
+        long int count[3]={0, 0, 0};
+        for (int b=0; b<3; b++)
+            data[b].reset(new T[chunk]);
+        IoTask reader, writer;
+        count[0]=in.read_at(data[0].get(), chunk*sizeof(T), 0)/sizeof(T);
+        for (long int begin=0, i=0; begin<total; begin+=chunk, i++){
+            int cur=i%3, nxt=(i+1)%3;
+            if (begin+chunk<total){
+                T *into=data[nxt].get();
+                long int *got=&count[nxt];
+                off_t offset=(off_t)(begin+chunk)*sizeof(T);
+                reader.start([&in, into, got, offset, chunk]{
+                    *got=in.read_at(into, chunk*sizeof(T), offset)/sizeof(T);
+                });
+            }
+            quick_sort_inplace(data[cur].get(), data[cur].get()+count[cur], comp);
+            writer.finish();
+            runs.push_back(ExternalRun{begin, count[cur]});
+            const T *from=data[cur].get();
+            long int n=count[cur];
+            ExternalFile *file=scratch.get();
+            writer.start([file, from, n, begin]{ file->write_at(from, n*sizeof(T), (off_t)begin*sizeof(T)); });
+            reader.finish();
+        }
+        writer.finish();
+    }
+
+    //every run gets two blocks and the output two more
+    long int min_block=EXTERNAL_MIN_BLOCK_BYTES/(long int)sizeof(T)+1;
+    long int fan_in=memory/(2*min_block*(long int)sizeof(T))-1;
+    if (fan_in<2)
+        fan_in=2;
+    long int max_block=EXTERNAL_BLOCK_BYTES/(long int)sizeof(T)+1;
+    std::unique_ptr<ExternalFile> other;
+    while ((long int)runs.size()>fan_in){
+        if (!other){
+            std::string other_path=scratch_path+".2";
+            other.reset(new ExternalFile(other_path, O_RDWR|O_CREAT|O_TRUNC));
+            ::unlink(other_path.c_str());
+        }
+        long int block=memory/(2*(fan_in+1)*(long int)sizeof(T));
+        if (block>max_block)
+            block=max_block;
+        if (block<1)
+            block=1;
+        std::vector<ExternalRun> merged;
+        for (long int g=0; g<(long int)runs.size(); g+=fan_in){
+            long int e=g+fan_in<(long int)runs.size() ? g+fan_in : (long int)runs.size();
+            std::vector<ExternalRun> group(runs.begin()+g, runs.begin()+e);
+            long int begin=group.front().begin, size=0;
+            for (auto &run: group)
+                size+=run.size;
+            merge_external_runs<T>(*scratch, group, *other, begin, block, comp);
+            merged.push_back(ExternalRun{begin, size});
+        }
+        runs.swap(merged);
+        scratch.swap(other);
+    }
+
+    long int k=(long int)runs.size();
+    long int block=memory/(2*(k+1)*(long int)sizeof(T));
+    if (block>max_block)
+        block=max_block;
+    if (block<1)
+        block=1;
+    ExternalFile out(output, O_WRONLY|O_CREAT|O_TRUNC);
+    merge_external_runs<T>(*scratch, runs, out, 0, block, comp);
+}
+
+#endif //VE281P1_EXTERNAL_SORT_HPP
@@ -0,0 +1,188 @@
+#include "convex_hull.hpp"
+#include "hull_query.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+/**
+ * Benchmark of the hull algorithms in convex_hull.hpp.
+ *
+ *   hull_bench [max]
+ *
+ * For n=1000, 10000, ... up to max (10^6 by default) points of every
+ * shape of bench_points, it times the Graham scan against Chan's
+ * algorithm, with and without the octagon filter in front. Then it feeds
+ * the same points in 100 batches and times DynamicHull against computing
+ * the hull again after every batch. Last, it times HullQuery containment
+ * queries, batched on all cores, against walking every edge of the hull.
+ * The exit status is 1 if any two hulls of the same points, or the two
+ * answers to a query, differ.
+ */
+
+//repetitions per measurement, the fastest one counts
+const int BENCH_REPEAT=3;
+//batches the points of the streaming measurement arrive in
+const long int BENCH_BATCHES=100;
+//containment queries per hull, and the hull edges walked for the first of them
+const long int BENCH_QUERIES=1000000;
+const long int BENCH_WALK_EDGES=50000000;
+
+/**
+ * n points of one shape. Uniform in a square or a disk the hull has
+ * O(log n) or O(n^(1/3)) vertices; rounded onto a circle many of the
+ * points, and on the parabola y=x^2 all of them, are hull vertices.
+ */
+vector<point> bench_points(const string &shape, long int n, mt19937_64 &rng){
+    const long int R=1000000000;
+    vector<point> all(n);
+    uniform_int_distribution<long int> coord(-R, R);
+    uniform_real_distribution<double> angle(0, 2*M_PI);
+    for (long int i=0; i<n; i++){
+        if (shape=="square")
+            all[i]={coord(rng), coord(rng)};
+        else if (shape=="disk"){
+            do
+                all[i]={coord(rng), coord(rng)};
+            while ((double)all[i].x*all[i].x+(double)all[i].y*all[i].y>(double)R*R);
+        }
+        else if (shape=="circle"){
+            double a=angle(rng);
+            all[i]={lround(R*cos(a)), lround(R*sin(a))};
+        }
+        else
+            all[i]={i-n/2, (i-n/2)*(i-n/2)};
+    }
+    shuffle(all.begin(), all.end(), rng);
+    return all;
+}
+
+//best of BENCH_REPEAT timings of run, in milliseconds
+template<typename Run>
+double best_time(Run run){
+    double best=1e300;
+    for (int r=0; r<BENCH_REPEAT; r++){
+        auto start=chrono::steady_clock::now();
+        run();
+        chrono::duration<double, milli> took=chrono::steady_clock::now()-start;
+        best=min(best, took.count());
+    }
+    return best;
+}
+
+//hull_fn on a copy of points, after the octagon filter if filter is set
+template<typename HullFn>
+double time_hull(const vector<point> &points, bool filter, vector<point> &hull, HullFn hull_fn){
+    vector<point> all;
+    return best_time([&]{
+        all=points;
+        hull.clear();
+        if (filter)
+            octagon_filter(all);
+        hull_fn(all, hull);
+    });
+}
+
+//containment by checking q against every edge, as in locate
+int walk_hull(const vector<point> &hull, const point &q){
+    long int h=(long int)hull.size();
+    if (h<3)
+        return HullQuery(hull).locate(q);
+    int where=1;
+    for (long int i=0; i<h; i++)
+        where=min(where, ccw(hull[i], hull[i+1<h ? i+1 : 0], q));
+    return where;
+}
+
+bool same_hull(const vector<point> &a, const vector<point> &b){
+    return a.size()==b.size() && equal(a.begin(), a.end(), b.begin(),
+        [](const point &u, const point &v){ return u.x==v.x && u.y==v.y; });
+}
+
+int main(int argc, char **argv){
+    long int max=argc>1 ? (long int)atof(argv[1]) : 1000000;
+    const char *shapes[]={"square", "disk", "circle", "parabola"};
+    mt19937_64 rng(281);
+    bool same=true;
+
+    printf("%-9s %10s %10s %12s %12s %12s %12s\n", "shape", "n", "h", "graham", "chan",
+        "graham-all", "chan-all");
+    for (string shape: shapes){
+        for (long int n=1000; n<=max; n*=10){
+            vector<point> points=bench_points(shape, n, rng), graham, chan;
+            double g=time_hull(points, true, graham, graham_hull);
+            double c=time_hull(points, true, chan, chan_hull);
+            double ga=time_hull(points, false, graham, graham_hull);
+            double ca=time_hull(points, false, chan, chan_hull);
+            bool ok=same_hull(graham, chan);
+            printf("%-9s %10ld %10ld %9.2f ms %9.2f ms %9.2f ms %9.2f ms%s\n", shape.c_str(), n,
+                (long int)graham.size(), g, c, ga, ca, ok ? "" : "  MISMATCH");
+            same&=ok;
+        }
+    }
+
+    printf("\n%-9s %10s %10s %12s %12s\n", "shape", "n", "batch", "dynamic", "rescan");
+    for (string shape: shapes){
+        for (long int n=1000; n<=max; n*=10){
+            vector<point> points=bench_points(shape, n, rng), dynamic, rescan, all;
+            long int batch=(n+BENCH_BATCHES-1)/BENCH_BATCHES;
+            double d=best_time([&]{
+                DynamicHull hull;
+                for (long int begin=0; begin<n; begin+=batch){
+                    hull.insert(points.begin()+begin, points.begin()+min(begin+batch, n));
+                    hull.hull(dynamic);
+                }
+            });
+            double r=best_time([&]{
+                for (long int begin=0; begin<n; begin+=batch){
+                    all.assign(points.begin(), points.begin()+min(begin+batch, n));
+                    rescan.clear();
+                    octagon_filter(all);
+                    graham_hull(all, rescan);
+                }
+            });
+            bool ok=same_hull(dynamic, rescan);
+            printf("%-9s %10ld %10ld %9.2f ms %9.2f ms%s\n", shape.c_str(), n, batch, d, r,
+                ok ? "" : "  MISMATCH");
+            same&=ok;
+        }
+    }
+
+    unsigned int cores=thread::hardware_concurrency();
+    ThreadPool pool(cores>1 ? cores-1 : 1);
+    printf("\n%-9s %10s %10s %12s %12s\n", "shape", "n", "h", "query", "walk");
+    for (string shape: shapes){
+        for (long int n=1000; n<=max; n*=10){
+            vector<point> points=bench_points(shape, n, rng), hull, queries;
+            graham_hull(points, hull);
+            HullQuery query(hull);
+            //a box a little larger than the points, so some of the queries are outside
+            uniform_int_distribution<long int> coord(-1100000000, 1100000000);
+            for (long int i=0; i<BENCH_QUERIES; i++)
+                queries.push_back(shape=="parabola" ? point{coord(rng)%n, coord(rng)%(n*n/4)} :
+                    point{coord(rng), coord(rng)});
+            long int walks=min(BENCH_QUERIES, BENCH_WALK_EDGES/(long int)hull.size());
+            vector<int8_t> where;
+            vector<int> walked(walks);
+            double q=best_time([&]{ query.locate(queries, where, pool); });
+            double w=best_time([&]{
+                for (long int i=0; i<walks; i++)
+                    walked[i]=walk_hull(hull, queries[i]);
+            });
+            bool ok=true;
+            for (long int i=0; i<walks; i++)
+                ok&=walked[i]==where[i];
+            printf("%-9s %10ld %10ld %9.2f ns %9.2f ns%s\n", shape.c_str(), n, (long int)hull.size(),
+                q*1e6/BENCH_QUERIES, w*1e6/walks, ok ? "" : "  MISMATCH");
+            same&=ok;
+        }
+    }
+    return same ? 0 : 1;
+}
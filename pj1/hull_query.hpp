@@ -0,0 +1,222 @@
+#ifndef VE281P1_HULL_QUERY_HPP
+#define VE281P1_HULL_QUERY_HPP
+
+#include "convex_hull.hpp"
+
+#include <utility>
+#include <vector>
+
+/**
+ * O(log h) queries against a hull in the form the algorithms of
+ * convex_hull.hpp return (counter-clockwise from p0, without collinear
+ * points).
+ * Containment is a binary search for the wedge around p0 that holds the
+ * point. Going round such a hull from p0 the edge directions turn through
+ * [0, 2pi) in order, so the extreme vertex in a direction is a binary
+ * search over the edge angles. The edges an outside point sees are
+ * consecutive; the containment search finds one of them and the extreme
+ * vertex away from the point is next to one it cannot see, so both
+ * tangents are binary searches between the two.
+ * The queries only read the hull, so threads can share one HullQuery; the
+ * batched versions split their queries over the threads of a pool.
+ */
+class HullQuery {
+public:
+    explicit HullQuery(const std::vector<point> &hull) : hull(hull), edge(hull.size()) {
+        long int h=size();
+        for (long int i=0; i<h; i++)
+            edge[i]={hull[next(i)].x-hull[i].x, hull[next(i)].y-hull[i].y};
+    }
+
+    long int size() const { return (long int)hull.size(); }
+
+    const point &operator[](long int i) const { return hull[i]; }
+
+    /**
+     * @return 1 if q is strictly inside the hull, 0 if on its boundary, -1 if outside
+     * Time complexity: O(log h)
+     */
+    int locate(const point &q) const {
+        long int seen;
+        return locate(q, seen);
+    }
+
+    //whether q is inside the hull or on its boundary
+    bool contains(const point &q) const { return locate(q)>=0; }
+
+    /**
+     * Index of the vertex farthest in direction d; if a side of the hull
+     * is perpendicular to d, the vertex that side starts at. 0 if d is 0.
+     * Time complexity: O(log h)
+     */
+    long int extreme(const point &d) const {
+        long int h=size();
+        if (h<2 || (d.x==0 && d.y==0))
+            return 0;
+        //the extreme vertex starts the first edge that has turned as far as d rotated by +90 degrees
+        point r={-d.y, d.x};
+        long int lo=0, hi=h;
+        while (lo<hi){
+            long int mid=(lo+hi)/2;
+            if (turns_before(edge[mid], r))
+                lo=mid+1;
+            else
+                hi=mid;
+        }
+        return lo<h ? lo : 0;
+    }
+
+    /**
+     * Tangents from q: the whole hull is left of or on q -> hull[left] and
+     * right of or on q -> hull[right]. If a side of the hull lies on a
+     * tangent, the nearer end of that side is taken.
+     * @return false (and no tangents) if q is not outside the hull
+     * Time complexity: O(log h)
+     */
+    bool tangents(const point &q, long int &left, long int &right) const {
+        long int h=size(), seen;
+        if (locate(q, seen)>=0)
+            return false;
+        if (h==1){
+            left=right=0;
+            return true;
+        }
+        if (h==2){
+            int turn=ccw(q, hull[0], hull[1]);
+            if (turn==0)
+                left=right=farther(q, hull[0], hull[1]) ? 1 : 0;
+            else{
+                left=turn>0 ? 0 : 1;
+                right=1-left;
+            }
+            return true;
+        }
+        //one of the two edges at the vertex extreme away from q is hidden from it
+        long int x=extreme({hull[0].x-q.x, hull[0].y-q.y});
+        long int hidden=sees(q, x) ? prev(x) : x;
+        left=first_edge(q, seen, hidden, false);
+        right=first_edge(q, hidden, seen, true);
+        return true;
+    }
+
+    //locate for every query, on the threads of pool
+    void locate(const std::vector<point> &queries, std::vector<int8_t> &where, ThreadPool &pool) const {
+        where.resize(queries.size());
+        for_each_query((long int)queries.size(), pool, [&](long int i){ where[i]=(int8_t)locate(queries[i]); });
+    }
+
+    //extreme for every direction, on the threads of pool
+    void extreme(const std::vector<point> &directions, std::vector<long int> &index, ThreadPool &pool) const {
+        index.resize(directions.size());
+        for_each_query((long int)directions.size(), pool, [&](long int i){ index[i]=extreme(directions[i]); });
+    }
+
+    //tangents for every query, on the threads of pool; both are -1 where the query is not outside
+    void tangents(const std::vector<point> &queries, std::vector<std::pair<long int, long int>> &found,
+        ThreadPool &pool) const {
+        found.resize(queries.size());
+        for_each_query((long int)queries.size(), pool, [&](long int i){
+            if (!tangents(queries[i], found[i].first, found[i].second))
+                found[i]={-1, -1};
+        });
+    }
+
+private:
+    long int next(long int i) const { return i+1<size() ? i+1 : 0; }
+
+    long int prev(long int i) const { return i>0 ? i-1 : size()-1; }
+
+    //whether q is strictly right of edge i, so that it sees the outside of that edge
+    bool sees(const point &q, long int i) const { return ccw(hull[i], hull[next(i)], q)<0; }
+
+    //0 for directions in [0, pi), 1 for [pi, 2pi)
+    static int half(const point &v) { return v.y<0 || (v.y==0 && v.x<0); }
+
+    //whether direction a comes before direction b in [0, 2pi)
+    static bool turns_before(const point &a, const point &b) {
+        if (half(a)!=half(b))
+            return half(a)<half(b);
+        return (__int128)a.x*b.y-(__int128)a.y*b.x>0;
+    }
+
+    /**
+     * q sees edge from and not edge to, or the other way round; going
+     * counter-clockwise between them that changes exactly once. Return the
+     * first edge after from that q sees (or does not see) like it does to.
+     */
+    long int first_edge(const point &q, long int from, long int to, bool seen) const {
+        long int h=size(), lo=1, hi=(to-from+h)%h;
+        while (lo<hi){
+            long int mid=(lo+hi)/2;
+            if (sees(q, (from+mid)%h)==seen)
+                hi=mid;
+            else
+                lo=mid+1;
+        }
+        return (from+lo)%h;
+    }
+
+    /**
+     * locate, and if q is outside, set seen to an edge q sees
+     */
+    int locate(const point &q, long int &seen) const {
+        long int h=size();
+        if (h==0)
+            return -1;
+        if (h==1)
+            return q.x==hull[0].x && q.y==hull[0].y ? 0 : -1;
+        int first=ccw(hull[0], hull[1], q);
+        if (first<0){
+            seen=0;
+            return -1;
+        }
+        if (h==2){
+            bool between=first==0 && std::min(hull[0].x, hull[1].x)<=q.x && q.x<=std::max(hull[0].x, hull[1].x)
+                && std::min(hull[0].y, hull[1].y)<=q.y && q.y<=std::max(hull[0].y, hull[1].y);
+            seen=1;
+            return between ? 0 : -1;
+        }
+        int last=ccw(hull[0], hull[h-1], q);
+        if (last>0){
+            seen=h-1;
+            return -1;
+        }
+        //the wedge hull[0], hull[i], hull[i+1] that q is in, i the last in [1, h-2] with q left of or on hull[0] -> hull[i]
+        long int lo=1, hi=h-2;
+        while (lo<hi){
+            long int mid=(lo+hi+1)/2;
+            if (ccw(hull[0], hull[mid], q)>=0)
+                lo=mid;
+            else
+                hi=mid-1;
+        }
+        int side=ccw(hull[lo], hull[lo+1], q);
+        if (side<0){
+            seen=lo;
+            return -1;
+        }
+        if (side==0)
+            return 0;
+        //the wedge's sides through hull[0] are on the boundary only in the first and last wedge
+        if ((lo==1 && first==0) || (lo+1==h-1 && last==0))
+            return 0;
+        return 1;
+    }
+
+    //body(i) for i in [0, n), in one block per thread of pool and the calling thread
+    template<typename Body>
+    static void for_each_query(long int n, ThreadPool &pool, Body body) {
+        unsigned int threads=pool.size()+1;
+        run_threads(pool, threads, [&](unsigned int t){
+            long int begin=n*t/threads, end=n*(t+1)/threads;
+            for (long int i=begin; i<end; i++)
+                body(i);
+        });
+    }
+
+    std::vector<point> hull;
+    //edge i goes from hull[i] to hull[i+1]
+    std::vector<point> edge;
+};
+
+#endif //VE281P1_HULL_QUERY_HPP
@@ -0,0 +1,359 @@
+#include "convex_hull.hpp"
+#include "hull_query.hpp"
+#include "rotating_calipers.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Regression tests for convex_hull.hpp, hull_query.hpp and
+ * rotating_calipers.hpp.
+ *
+ *   hull_test
+ *
+ * Prints every check that fails; the exit status is 1 if any did.
+ */
+
+static int failures=0;
+
+void check(bool ok, const string &what){
+    if (ok)
+        return ;
+    printf("FAILED: %s\n", what.c_str());
+    failures++;
+}
+
+bool same_hull(const vector<point> &a, const vector<point> &b){
+    return a.size()==b.size() && equal(a.begin(), a.end(), b.begin(),
+        [](const point &u, const point &v){ return u.x==v.x && u.y==v.y; });
+}
+
+/**
+ * n points of one shape: on a small grid, so that many of them repeat and
+ * line up; on a few lines, including a horizontal and a vertical one; on
+ * the border of a square, every side a collinear run; on the parabola
+ * y=x^2, every distinct one a hull vertex; rounded onto a long, slanted
+ * ellipse, most of them hull vertices; spread over a large square; on
+ * one line only; or all the same point.
+ */
+vector<point> test_points(const string &shape, long int n, mt19937_64 &rng){
+    vector<point> all(n);
+    for (long int i=0; i<n; i++){
+        long int t=(long int)(rng()%41)-20;
+        if (shape=="grid")
+            all[i]={(long int)(rng()%7)-3, (long int)(rng()%7)-3};
+        else if (shape=="lines"){
+            switch (rng()%3){
+                case 0: all[i]={t, 2*t+1}; break;
+                case 1: all[i]={t, 5}; break;
+                default: all[i]={-4, t}; break;
+            }
+        }
+        else if (shape=="border"){
+            switch (rng()%4){
+                case 0: all[i]={t, -20}; break;
+                case 1: all[i]={20, t}; break;
+                case 2: all[i]={t, 20}; break;
+                default: all[i]={-20, t}; break;
+            }
+        }
+        else if (shape=="parabola")
+            all[i]={t, t*t};
+        else if (shape=="ellipse"){
+            double a=(double)(rng()%1000000)/1000000*2*M_PI;
+            all[i]={lround(1000000*cos(a)), lround(100000*sin(a)+300000*cos(a))};
+        }
+        else if (shape=="segment")
+            all[i]={3*t, -t};
+        else if (shape=="spread")
+            all[i]={(long int)(rng()%2000000001)-1000000000, (long int)(rng()%2000000001)-1000000000};
+        else
+            all[i]={7, -3};
+    }
+    return all;
+}
+
+const char *const TEST_SHAPES[]={"grid", "lines", "border", "parabola", "ellipse", "spread", "segment", "same"};
+
+/**
+ * DynamicHull fed in batches, and one point at a time: after every batch
+ * its hull has to equal graham_hull of all the points seen so far.
+ */
+void test_dynamic_hull(mt19937_64 &rng){
+    for (const char *shape: TEST_SHAPES){
+        for (long int batch: {1L, 3L, 50L}){
+            vector<point> all=test_points(shape, 600, rng);
+            DynamicHull dynamic;
+            vector<point> seen, expect, got;
+            for (long int begin=0; begin<(long int)all.size(); begin+=batch){
+                long int end=min(begin+batch, (long int)all.size());
+                if (batch==1)
+                    dynamic.insert(all[begin]);
+                else
+                    dynamic.insert(all.begin()+begin, all.begin()+end);
+                seen.insert(seen.end(), all.begin()+begin, all.begin()+end);
+                vector<point> copy=seen;
+                expect.clear();
+                graham_hull(copy, expect);
+                dynamic.hull(got);
+                if (!same_hull(got, expect)){
+                    check(false, "DynamicHull after "+to_string(end)+" "+shape+" points in batches of "
+                        +to_string(batch));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+//the hulls of every shape, the hulls with one and two vertices among them
+vector<vector<point>> test_hulls(mt19937_64 &rng){
+    vector<vector<point>> hulls;
+    for (const char *shape: TEST_SHAPES){
+        for (long int n: {2L, 5L, 100L}){
+            vector<point> all=test_points(shape, n, rng), hull;
+            graham_hull(all, hull);
+            hulls.push_back(hull);
+        }
+    }
+    hulls.push_back({{-1000000000, 1000000000}});
+    hulls.push_back({{0, -5}, {1000000000, 999999995}});
+    return hulls;
+}
+
+/**
+ * Query points for hull: inside and around its bounding box, the
+ * vertices, the lattice points on every edge and on the line through it
+ * past both ends, and far away.
+ */
+vector<point> test_queries(const vector<point> &hull, mt19937_64 &rng){
+    long int h=(long int)hull.size();
+    long int lox=hull[0].x, hix=hull[0].x, loy=hull[0].y, hiy=hull[0].y;
+    for (auto &v: hull){
+        lox=min(lox, v.x);
+        hix=max(hix, v.x);
+        loy=min(loy, v.y);
+        hiy=max(hiy, v.y);
+    }
+    long int padx=(hix-lox)/4+2, pady=(hiy-loy)/4+2;
+    vector<point> queries(hull.begin(), hull.end());
+    for (int i=0; i<300; i++)
+        queries.push_back({lox-padx+(long int)(rng()%(unsigned long int)(hix-lox+2*padx+1)),
+            loy-pady+(long int)(rng()%(unsigned long int)(hiy-loy+2*pady+1))});
+    for (long int i=0; i<h && h>1; i++){
+        const point &a=hull[i], &b=hull[i+1<h ? i+1 : 0];
+        long int g=gcd(abs(b.x-a.x), abs(b.y-a.y));
+        point step={(b.x-a.x)/g, (b.y-a.y)/g};
+        for (long int k: {-3L, -1L, 1L, g/2, g-1, g+1, g+3})
+            queries.push_back({a.x+k*step.x, a.y+k*step.y});
+    }
+    for (long int x: {-2000000000L, 0L, 2000000000L})
+        for (long int y: {-2000000000L, 0L, 2000000000L})
+            queries.push_back({x, y});
+    return queries;
+}
+
+//whether q lies on the segment from a to b
+bool on_segment(const point &a, const point &b, const point &q){
+    return ccw(a, b, q)==0 && min(a.x, b.x)<=q.x && q.x<=max(a.x, b.x) && min(a.y, b.y)<=q.y && q.y<=max(a.y, b.y);
+}
+
+//locate by checking q against every edge
+int brute_locate(const vector<point> &hull, const point &q){
+    long int h=(long int)hull.size();
+    if (h==1)
+        return hull[0].x==q.x && hull[0].y==q.y ? 0 : -1;
+    if (h==2)
+        return on_segment(hull[0], hull[1], q) ? 0 : -1;
+    int where=1;
+    for (long int i=0; i<h; i++)
+        where=min(where, ccw(hull[i], hull[i+1<h ? i+1 : 0], q));
+    return where;
+}
+
+__int128 dot(const point &a, const point &b){
+    return (__int128)a.x*b.x+(__int128)a.y*b.y;
+}
+
+/**
+ * Whether v is the answer to extreme(d): no vertex is farther in
+ * direction d, and if the next vertex is as far, the previous one is not
+ */
+bool brute_extreme(const vector<point> &hull, const point &d, long int v){
+    long int h=(long int)hull.size();
+    if (v<0 || v>=h)
+        return false;
+    if (d.x==0 && d.y==0)
+        return v==0;
+    for (auto &u: hull)
+        if (dot(d, u)>dot(d, hull[v]))
+            return false;
+    return h<3 || dot(d, hull[v>0 ? v-1 : h-1])<dot(d, hull[v]);
+}
+
+/**
+ * Whether t is the tangent from q on side turn (1 for left, -1 for
+ * right): no vertex is on the other side of q -> hull[t], and no vertex
+ * on that line is nearer to q
+ */
+bool brute_tangent(const vector<point> &hull, const point &q, long int t, int turn){
+    if (t<0 || t>=(long int)hull.size())
+        return false;
+    for (auto &u: hull){
+        int side=ccw(q, hull[t], u);
+        if (side==-turn || (side==0 && (u.x!=hull[t].x || u.y!=hull[t].y) && farther(q, hull[t], u)))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * HullQuery against brute force over every vertex or edge: locate at
+ * random and boundary points, extreme in random directions and along the
+ * normals of the edges, and tangents from every query point outside.
+ */
+void test_hull_query(mt19937_64 &rng){
+    for (auto &hull: test_hulls(rng)){
+        HullQuery query(hull);
+        long int h=(long int)hull.size();
+        string what=" of a hull with "+to_string(h)+" vertices";
+        for (auto &q: test_queries(hull, rng)){
+            string at=" at ("+to_string(q.x)+", "+to_string(q.y)+")"+what;
+            int where=query.locate(q);
+            check(where==brute_locate(hull, q), "HullQuery::locate"+at);
+            long int left=-1, right=-1;
+            bool outside=query.tangents(q, left, right);
+            check(outside==(where<0), "HullQuery::tangents finds tangents only from outside"+at);
+            if (outside)
+                check(brute_tangent(hull, q, left, 1) && brute_tangent(hull, q, right, -1), "HullQuery::tangents"+at);
+        }
+        vector<point> directions={{0, 0}};
+        for (int i=0; i<100; i++)
+            directions.push_back({(long int)(rng()%7)-3, (long int)(rng()%7)-3});
+        for (int i=0; i<100; i++)
+            directions.push_back({(long int)(rng()%2000000001)-1000000000, (long int)(rng()%2000000001)-1000000000});
+        for (long int i=0; i<h; i++){
+            const point &a=hull[i], &b=hull[i+1<h ? i+1 : 0];
+            directions.push_back({b.y-a.y, a.x-b.x});
+            directions.push_back({a.y-b.y, b.x-a.x});
+        }
+        for (auto &d: directions)
+            check(brute_extreme(hull, d, query.extreme(d)),
+                "HullQuery::extreme in ("+to_string(d.x)+", "+to_string(d.y)+")"+what);
+    }
+}
+
+//whether a and b agree to about 1e-9 of scale
+bool close(long double a, long double b, long double scale){
+    return fabsl(a-b)<=1e-9L*(scale>1 ? scale : 1);
+}
+
+/**
+ * hull_diameter, hull_width and hull_min_rectangle against every pair of
+ * vertices and every edge with every vertex, on the same hulls as
+ * HullQuery: the value has to match, and the vertices, edge and corners
+ * returned have to attain it.
+ */
+void test_rotating_calipers(mt19937_64 &rng){
+    for (auto &hull: test_hulls(rng)){
+        long int h=(long int)hull.size();
+        string what=" of a hull with "+to_string(h)+" vertices";
+        auto squared=[&](long int a, long int b){ return dot({hull[b].x-hull[a].x, hull[b].y-hull[a].y},
+            {hull[b].x-hull[a].x, hull[b].y-hull[a].y}); };
+        long double scale=0;
+        for (auto &v: hull)
+            scale=max(scale, (long double)max(abs(v.x), abs(v.y)));
+
+        __int128 farthest=0;
+        for (long int a=0; a<h; a++)
+            for (long int b=0; b<h; b++)
+                farthest=max(farthest, squared(a, b));
+        HullDiameter diameter=hull_diameter(hull);
+        check(0<=diameter.first && diameter.first<h && 0<=diameter.second && diameter.second<h
+            && squared(diameter.first, diameter.second)==farthest
+            && close(diameter.length, sqrtl((long double)farthest), scale), "hull_diameter"+what);
+
+        //for every edge, how far the hull reaches ahead, behind and above it, times the edge's length
+        vector<long double> ahead(h), behind(h), above(h);
+        long double narrowest=h<3 ? 0 : INFINITY, smallest=h<2 ? 0 : INFINITY;
+        for (long int i=0; i<h && h>1; i++){
+            const point &a=hull[i], &b=hull[(i+1)%h];
+            for (auto &v: hull){
+                ahead[i]=max(ahead[i], (long double)caliper_dot(a, b, a, v));
+                behind[i]=min(behind[i], (long double)caliper_dot(a, b, a, v));
+                above[i]=max(above[i], (long double)caliper_cross(a, b, a, v));
+            }
+            long double squared=(long double)caliper_dot(a, b, a, b);
+            if (h>=3)
+                narrowest=min(narrowest, above[i]/sqrtl(squared));
+            smallest=min(smallest, (ahead[i]-behind[i])*above[i]/squared);
+        }
+        HullWidth width=hull_width(hull);
+        bool ok=close(width.width, narrowest, scale);
+        if (h>=3){
+            const point &a=hull[width.edge], &b=hull[(width.edge+1)%h];
+            ok=ok && (long double)caliper_cross(a, b, a, hull[width.vertex])==above[width.edge]
+                && close(above[width.edge]/sqrtl((long double)caliper_dot(a, b, a, b)), narrowest, scale);
+        }
+        check(ok, "hull_width"+what);
+
+        HullRectangle rectangle=hull_min_rectangle(hull);
+        ok=close(rectangle.area, smallest, scale*scale);
+        //the corners span the area, and every vertex is inside them
+        long double corners=0;
+        for (int c=0; c<4; c++)
+            corners+=(long double)rectangle.x[c]*rectangle.y[(c+1)%4]-(long double)rectangle.x[(c+1)%4]*rectangle.y[c];
+        ok=ok && close(corners/2, smallest, scale*scale);
+        long double ux=rectangle.x[1]-rectangle.x[0], uy=rectangle.y[1]-rectangle.y[0];
+        long double vx=rectangle.x[3]-rectangle.x[0], vy=rectangle.y[3]-rectangle.y[0];
+        long double u=sqrtl(ux*ux+uy*uy), v=sqrtl(vx*vx+vy*vy);
+        for (auto &p: hull){
+            long double px=p.x-rectangle.x[0], py=p.y-rectangle.y[0];
+            long double along=u>0 ? (px*ux+py*uy)/u : 0, up=v>0 ? (px*vx+py*vy)/v : 0;
+            ok=ok && along>=-1e-9L*scale && along<=u+1e-9L*scale && up>=-1e-9L*scale && up<=v+1e-9L*scale
+                && (u>0 || fabsl(px)+fabsl(py)<=1e-9L*scale);
+        }
+        check(ok, "hull_min_rectangle"+what);
+    }
+}
+
+/**
+ * chan_hull against graham_hull on inputs of several groups of
+ * CHAN_FIRST_GUESS points, one of them with more hull vertices than that
+ * first guess, so that the wrap gives up and the guess is squared
+ */
+void test_chan_hull(mt19937_64 &rng){
+    vector<vector<point>> inputs;
+    for (const char *shape: TEST_SHAPES)
+        inputs.push_back(test_points(shape, 3*CHAN_FIRST_GUESS+5, rng));
+    vector<point> parabola;
+    for (long int x=0; x<2*CHAN_FIRST_GUESS; x++)
+        parabola.push_back({x, x*x});
+    shuffle(parabola.begin(), parabola.end(), rng);
+    inputs.push_back(parabola);
+    for (auto &all: inputs){
+        vector<point> copy=all, expect, got;
+        graham_hull(copy, expect);
+        copy=all;
+        chan_hull(copy, got);
+        check(same_hull(got, expect), "chan_hull on "+to_string(all.size())+" points with "
+            +to_string(expect.size())+" hull vertices");
+    }
+}
+
+int main(){
+    mt19937_64 rng(281);
+    test_dynamic_hull(rng);
+    test_chan_hull(rng);
+    test_hull_query(rng);
+    test_rotating_calipers(rng);
+    if (failures==0)
+        printf("all tests passed\n");
+    return failures>0 ? 1 : 0;
+}
@@ -0,0 +1,98 @@
+#ifndef VE281P1_ORIENTATION_HPP
+#define VE281P1_ORIENTATION_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Exact orientation predicates for the convex hull.
+ * Cross products are formed in 128 bits, so the sign is exact for all
+ * coordinates below 2^62 in magnitude (the differences still have to fit
+ * in a long int). orientation_batch classifies many points against one
+ * edge at a time, four per step with AVX2 when the compiler targets it
+ * and the differences fit in 32 bits, with the scalar predicate
+ * otherwise.
+ */
+
+struct point {
+    long int x;
+    long int y;
+};
+
+/**
+ * Orientation of the turn a -> b -> c
+ * @return 1 if counter-clockwise, -1 if clockwise, 0 if collinear
+ */
+inline int orientation(const point &a, const point &b, const point &c){
+    __int128 det=(__int128)(b.x-a.x)*(c.y-a.y)-(__int128)(b.y-a.y)*(c.x-a.x);
+    return (det>0)-(det<0);
+}
+
+//points classified per orientation_batch call by the callers that work in chunks
+const long int ORIENTATION_BATCH=512;
+
+#if defined(__AVX2__)
+
+//byte j is 1 if bit j of the index is set, for spreading a 4-lane mask over 4 sign bytes
+static const uint32_t ORIENTATION_BYTES[16]={
+    0x00000000, 0x00000001, 0x00000100, 0x00000101, 0x00010000, 0x00010001, 0x00010100, 0x00010101,
+    0x01000000, 0x01000001, 0x01000100, 0x01000101, 0x01010000, 0x01010001, 0x01010100, 0x01010101};
+
+//whether every 64-bit lane of v is in [-2^31, 2^31)
+inline bool fits_int32(__m256i v){
+    __m256i high=_mm256_srli_epi64(_mm256_add_epi64(v, _mm256_set1_epi64x(1ll<<31)), 32);
+    return _mm256_testz_si256(high, high);
+}
+
+/**
+ * Cross products of the edge with two points relative to a, in lanes 0
+ * and 2. d holds dx0 dy0 dx1 dy1, edge holds ey ex ey ex, all fitting in
+ * 32 bits, so the 32x32->64 multiply is exact and so is the difference.
+ */
+inline __m256i cross_pair(__m256i d, __m256i edge){
+    __m256i prod=_mm256_mul_epi32(d, edge);
+    return _mm256_sub_epi64(_mm256_shuffle_epi32(prod, 0x4E), prod);
+}
+
+#endif
+
+/**
+ * sign[i]=orientation(a, b, points[i]) for i in [0, n)
+ */
+inline void orientation_batch(const point &a, const point &b, const point *points, long int n, int8_t *sign){
+    long int i=0;
+#if defined(__AVX2__)
+    static_assert(sizeof(point)==2*sizeof(int64_t), "points are loaded as pairs of int64");
+    long int ex=b.x-a.x, ey=b.y-a.y;
+    __m256i edge=_mm256_setr_epi64x(ey, ex, ey, ex);
+    if (fits_int32(edge)){
+        __m256i origin=_mm256_setr_epi64x(a.x, a.y, a.x, a.y);
+        __m256i zero=_mm256_setzero_si256();
+        for (; i+4<=n; i+=4){
+            __m256i d01=_mm256_sub_epi64(_mm256_loadu_si256((const __m256i *)(points+i)), origin);
+            __m256i d23=_mm256_sub_epi64(_mm256_loadu_si256((const __m256i *)(points+i+2)), origin);
+            if (!fits_int32(d01) || !fits_int32(d23)){
+                for (long int j=i; j<i+4; j++)
+                    sign[j]=(int8_t)orientation(a, b, points[j]);
+                continue;
+            }
+            //lanes 0, 2 of the first and 1, 3 of the second, then back into point order
+            __m256i det=_mm256_blend_epi32(cross_pair(d01, edge),
+                _mm256_shuffle_epi32(cross_pair(d23, edge), 0x4E), 0xCC);
+            det=_mm256_permute4x64_epi64(det, 0xD8);
+            int positive=_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(det, zero)));
+            int negative=_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(zero, det)));
+            uint32_t packed=ORIENTATION_BYTES[positive]|(ORIENTATION_BYTES[negative]*0xFF);
+            memcpy(sign+i, &packed, sizeof(packed));
+        }
+    }
+#endif
+    for (; i<n; i++)
+        sign[i]=(int8_t)orientation(a, b, points[i]);
+}
+
+#endif //VE281P1_ORIENTATION_HPP
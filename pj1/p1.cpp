@@ -1,117 +1,301 @@
+#include "convex_hull.hpp"
+#include "rotating_calipers.hpp"
+
 #include <algorithm>
 #include <vector>
 #include <iostream>
-using namespace std;
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
 
-typedef struct point{
-    long int x;
-    long int y;
-}p;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
 
-void swap(vector<p> &vector,  long int i, long int j){
-    auto temp= vector[i];
-    vector[i]=vector[j];
-    vector[j]=temp;
-}
+typedef point p;
 
-void input_points(vector<p> &all, long int num){
-    for (long int i=0; i<num; i++){
-        long int x, y;
-        cin>>x>>y;
-        all.push_back({x,y});
-    }    
-}
+//input blocks read at once when the input cannot be mapped
+const long int READ_BLOCK=1<<24;
 
-void find_p0(vector<p> &all){
-    long int index=0;
-    for (long int i=0; i<(long int)all.size(); i++){
-        if (all[i].y<all[index].y)
-            index=i;
-        else if (all[i].y==all[index].y){
-            if (all[i].x<all[index].x)
-                index=i;
+/**
+ * The whole input in memory: mapped if it is a regular file, read in
+ * large blocks otherwise (pipes, terminals)
+ */
+class Input {
+public:
+    explicit Input(int fd) : data(nullptr), size(0), mapped(false) {
+        struct stat st;
+        if (fstat(fd, &st)==0 && S_ISREG(st.st_mode) && st.st_size>0){
+            void *map=mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE|MAP_POPULATE, fd, 0);
+            if (map!=MAP_FAILED){
+                data=(const char *)map;
+                size=st.st_size;
+                mapped=true;
+                return ;
+            }
+        }
+        while (true){
+            buffer.resize(size+READ_BLOCK);
+            ssize_t got=read(fd, buffer.data()+size, READ_BLOCK);
+            if (got<0 && errno==EINTR)
+                continue;
+            if (got<=0)
+                break;
+            size+=got;
         }
-        else{}
+        data=buffer.data();
     }
-    swap(all, index, 0);    
-}
-
-template<typename T, typename Compare>
-void std_sort(vector<T> &vector, Compare comp = less<T>()) {
-    sort(vector.begin(), vector.end(), comp);
-}
 
-long int ccw(const p &p1, const p &p2, const p &p3){
-    return ((p2.x-p1.x)*(p3.y-p1.y)-(p2.y-p1.y)*(p3.x-p1.x));
-}
+    Input(const Input &)=delete;
+    Input &operator=(const Input &)=delete;
 
-bool compare_p(const p &p0, const p &p1, const p&p2){
-    if (ccw(p0, p1, p2)>0)
-        return 1;
-    if ((ccw(p0, p1, p2)==0)){
-        if (p1.x!=p2.x || p1.y!= p2.y){
-            if (abs(p1.x-p0.x)<abs(p2.x-p0.x) || abs(p1.y-p0.y)<abs(p2.y-p0.y))
-                return 1;
-        }
-        else
-            return 1;
+    ~Input(){
+        if (mapped)
+            munmap((void *)data, size);
     }
-    return 0;      
-}
 
-struct Compareless{
-    p p0;
-    bool operator()(const p &p1, const p& p2) const{
-        return compare_p(p0, p1, p2);
-    }
+    const char *data;
+    long int size;
+
+private:
+    bool mapped;
+    vector<char> buffer;
 };
 
-void erase_same(vector<p> &all){
-    if (all.size()<2)
-        return ;
-    if (all.size()==2){
-        if (all[0].x==all[1].x && all[0].y==all[1].y)
-            all.erase(all.begin());
-    }
-    for (auto i=all.end()-1; i>all.begin()+1; i--){
-        if (ccw(all[0],*i, *(i-1))==0)
-            all.erase(i-1);  
+/**
+ * Reads decimal integers separated by anything else
+ */
+struct TextReader {
+    const char *pos, *end;
+
+    //return false at the end of the input
+    bool next(long int &value){
+        while (pos<end && *pos!='-' && (*pos<'0' || *pos>'9'))
+            pos++;
+        if (pos==end)
+            return false;
+        bool negative=*pos=='-';
+        if (negative)
+            pos++;
+        unsigned long int v=0;
+        while (pos<end && *pos>='0' && *pos<='9')
+            v=v*10+(*pos++-'0');
+        value=negative ? -(long int)v : (long int)v;
+        return true;
     }
-    if (all[0].x==all[1].x && all[0].y==all[1].y)
-        all.erase(all.begin());
+};
+
+/**
+ * Text input: the number of points, then x y for every point
+ * @return false if the input ends early
+ */
+bool input_points(TextReader &in, vector<p> &all, long int num){
+    all.resize(num);
+    for (long int i=0; i<num; i++)
+        if (!in.next(all[i].x) || !in.next(all[i].y))
+            return false;
+    return true;
 }
 
-void scan(vector<p> &all, vector<p> &hull){
-    for (auto it:all){
-        while(hull.size()>1 && ccw(*(hull.end()-2), *(hull.end()-1), it)<=0){
-            hull.pop_back();
-        }
-        hull.push_back(it);
-    }
+/**
+ * Binary input: the number of points and then x, y of every point, all
+ * as native 64-bit integers, so the points are copied as they are
+ * @return false if the input ends early
+ */
+bool input_points(const Input &in, vector<p> &all, long int &num){
+    static_assert(sizeof(p)==2*sizeof(int64_t), "points are read as two int64 each");
+    if (in.size<(long int)sizeof(int64_t))
+        return false;
+    int64_t count;
+    memcpy(&count, in.data, sizeof(count));
+    num=count;
+    if (num<0 || (in.size-(long int)sizeof(int64_t))/(long int)sizeof(p)<num)
+        return false;
+    all.resize(num);
+    memcpy(all.data(), in.data+sizeof(int64_t), num*sizeof(p));
+    return true;
+}
+
+//write v in decimal at out, return the end
+char *put_long(char *out, long int v){
+    unsigned long int u=v<0 ? 0-(unsigned long int)v : (unsigned long int)v;
+    if (v<0)
+        *out++='-';
+    char digits[20];
+    int n=0;
+    do {
+        digits[n++]=(char)('0'+u%10);
+        u/=10;
+    } while (u>0);
+    while (n>0)
+        *out++=digits[--n];
+    return out;
 }
 
 void print(vector<p> &all){
-    for(auto it: all){
-        cout<<it.x<<' '<<it.y<<endl;
+    //formatted into one buffer and written at once: per point up to 2 signs, 40 digits, 2 separators
+    vector<char> out(all.size()*44);
+    char *at=out.data();
+    for (auto &it: all){
+        at=put_long(at, it.x);
+        *at++=' ';
+        at=put_long(at, it.y);
+        *at++='\n';
+    }
+    fwrite(out.data(), 1, at-out.data(), stdout);
+    fflush(stdout);
+}
+
+/**
+ * The rotating calipers metrics of the hull that were asked for, one line
+ * each on standard error so that standard output stays the hull:
+ *   diameter length x1 y1 x2 y2
+ *   width width x1 y1 x2 y2 x3 y3    (the edge 1-2 and the vertex 3 opposite it)
+ *   rectangle area x1 y1 ... x4 y4   (corners counter-clockwise)
+ */
+void print_metrics(const vector<p> &hull, bool diameter, bool width, bool rectangle){
+    long int h=(long int)hull.size();
+    if (h==0)
+        return ;
+    if (diameter){
+        HullDiameter d=hull_diameter(hull);
+        fprintf(stderr, "diameter %.6f %ld %ld %ld %ld\n", d.length, hull[d.first].x, hull[d.first].y,
+            hull[d.second].x, hull[d.second].y);
+    }
+    if (width){
+        HullWidth w=hull_width(hull);
+        const p &a=hull[w.edge], &b=hull[(w.edge+1)%h], &c=hull[w.vertex];
+        fprintf(stderr, "width %.6f %ld %ld %ld %ld %ld %ld\n", w.width, a.x, a.y, b.x, b.y, c.x, c.y);
+    }
+    if (rectangle){
+        HullRectangle r=hull_min_rectangle(hull);
+        fprintf(stderr, "rectangle %.6f", r.area);
+        for (int c=0; c<4; c++)
+            fprintf(stderr, " %.6f %.6f", r.x[c], r.y[c]);
+        fprintf(stderr, "\n");
     }
 }
 
-int main(){
+/**
+ * p1 [--binary] [--no-filter] [--chan | --threads n | --batch k]
+ *    [--diameter] [--width] [--rectangle] [--metrics] [file]
+ * Reads the points from file (standard input by default), as text or in
+ * the binary format of input_points, and prints the convex hull.
+ * --no-filter sorts all points instead of only those octagon_filter keeps.
+ * --chan runs Chan's algorithm instead of the Graham scan. Together with
+ * --no-filter it pays off when the hull has few vertices (about twice as
+ * fast on the square and disk of hull_bench); behind the filter the two
+ * are about even, and on large hulls the Graham scan is faster.
+ * --threads runs parallel_hull on n threads (0: all cores) instead of the
+ * Graham scan; on one thread it stays the Graham scan, without a pool.
+ * --batch feeds the points to a DynamicHull k at a time and prints the hull
+ * after every batch, with an empty line between two hulls.
+ * --diameter, --width and --rectangle measure the (last) hull with the
+ * rotating calipers, see print_metrics; --metrics asks for all three.
+ */
+int main(int argc, char **argv){
     long int num;
     vector<p> allPoints;
     vector<p> hullStack;
-    Compareless c;
 
-    cin>>num;
+    bool binary=false, filter=true, chan=false, usage=false;
+    bool diameter=false, width=false, rectangle=false;
+    long int threads=-1, batch=0;
+    string path;
+    for (int i=1; i<argc && !usage; i++){
+        string arg=argv[i];
+        if (arg=="--binary")
+            binary=true;
+        else if (arg=="--no-filter")
+            filter=false;
+        else if (arg=="--chan")
+            chan=true;
+        else if (arg=="--threads" && i+1<argc)
+            threads=atol(argv[++i]);
+        else if (arg=="--batch" && i+1<argc && atol(argv[i+1])>0)
+            batch=atol(argv[++i]);
+        else if (arg=="--diameter")
+            diameter=true;
+        else if (arg=="--width")
+            width=true;
+        else if (arg=="--rectangle")
+            rectangle=true;
+        else if (arg=="--metrics")
+            diameter=width=rectangle=true;
+        else if (path.empty() && arg[0]!='-')
+            path=arg;
+        else
+            usage=true;
+    }
+    if (usage || chan+(threads>=0)+(batch>0)>1){
+        cerr<<"usage: "<<argv[0]<<" [--binary] [--no-filter] [--chan | --threads n | --batch k]"
+            <<" [--diameter] [--width] [--rectangle] [--metrics] [file]"<<endl;
+        return 2;
+    }
+    int fd=path.empty() ? 0 : open(path.c_str(), O_RDONLY);
+    if (fd<0){
+        cerr<<"cannot open "<<path<<endl;
+        return 1;
+    }
+    {
+        Input in(fd);
+        if (binary){
+            if (!input_points(in, allPoints, num)){
+                cerr<<"truncated binary input"<<endl;
+                return 1;
+            }
+        }
+        else{
+            TextReader reader={in.data, in.data+in.size};
+            if (!reader.next(num))
+                return 0;
+            if (num<0){
+                cerr<<"negative point count "<<num<<endl;
+                return 1;
+            }
+            if (num>0 && !input_points(reader, allPoints, num)){
+                cerr<<"expected "<<num<<" points"<<endl;
+                return 1;
+            }
+        }
+    }
+    if (fd>0)
+        close(fd);
     if (num==0)
         return 0;
-    input_points(allPoints, num);
 
-    find_p0(allPoints);
-    c.p0=allPoints[0];    
-    std_sort(allPoints, c);
-    erase_same(allPoints);
-    scan(allPoints,hullStack);
+    if (threads==0)
+        threads=thread::hardware_concurrency();
+    if (threads>1){
+        //the calling thread works along with the pool
+        ThreadPool pool((unsigned int)threads-1);
+        if (filter)
+            octagon_filter(allPoints, pool);
+        parallel_hull(allPoints, hullStack, pool);
+        print(hullStack);
+    }
+    else if (batch>0){
+        DynamicHull dynamic;
+        for (long int begin=0; begin<num; begin+=batch){
+            dynamic.insert(allPoints.begin()+begin, allPoints.begin()+min(begin+batch, num));
+            dynamic.hull(hullStack);
+            if (begin>0)
+                putchar('\n');
+            print(hullStack);
+        }
+    }
+    else{
+        if (filter)
+            octagon_filter(allPoints);
+        if (chan)
+            chan_hull(allPoints, hullStack);
+        else
+            graham_hull(allPoints, hullStack);
+        print(hullStack);
+    }
 
-    print(hullStack);
+    print_metrics(hullStack, diameter, width, rectangle);
 }
\ No newline at end of file
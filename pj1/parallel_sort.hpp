@@ -0,0 +1,282 @@
+#ifndef VE281P1_PARALLEL_SORT_HPP
+#define VE281P1_PARALLEL_SORT_HPP
+
+#include "sort.hpp"
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <iterator>
+
+//inputs shorter than this are not worth spawning threads for
+const long int PARALLEL_SORT_CUTOFF=1<<15;
+//sample elements drawn per bucket when picking splitters
+const long int OVERSAMPLE=32;
+//buckets per thread, so that handing them out one at a time evens out their sizes
+const long int BUCKETS_PER_THREAD=8;
+
+/**
+ * Run body(t) for t in [0, threads), t=0 on the calling thread.
+ */
+template<typename Body>
+void run_threads(unsigned int threads, Body body){
+    std::vector<std::thread> workers;
+    for (unsigned int t=1; t<threads; t++)
+        workers.emplace_back(body, t);
+    body(0);
+    for (auto &w: workers)
+        w.join();
+}
+
+/**
+ * Same as above, but on the tasks of a shared pool.
+ */
+template<typename Body>
+void run_threads(ThreadPool &pool, unsigned int threads, Body body){
+    TaskGroup group(pool);
+    for (unsigned int t=1; t<threads; t++)
+        group.run([&body, t]{ body(t); });
+    body(0);
+    group.wait();
+}
+
+/**
+ * Parallel sample sort.
+ * Splitters are drawn from an oversample and deduplicated; every splitter
+ * gets an "equal" bucket next to its "less" bucket, so inputs with few
+ * distinct keys do not end up in a single bucket. Each thread classifies
+ * one block and counts a private histogram, the histograms are turned
+ * into scatter offsets, the blocks are scattered into one buffer and
+ * finally the buckets, several per thread, are handed out one at a time
+ * and sorted with the sequential introsort, so one large bucket does not
+ * hold up the rest. Equal buckets need no sorting at all.
+ * Not stable. T has to be default constructible.
+ * Time complexity: O(n log n / threads) expected, O(n) extra space
+ */
+template<typename T, typename Compare, typename Runner>
+void sample_sort_helper(std::vector<T> &vector, Compare comp, unsigned int threads, Runner run){
+    long int n=(long int)vector.size();
+    if (threads==0)
+        threads=1;
+    if (threads==1 || n<PARALLEL_SORT_CUTOFF){
+        quick_sort_inplace(vector, comp);
+        return ;
+    }
+
+    //oversample with a fixed LCG so runs are reproducible; samples and
+    //splitters are positions, so no element is copied
+    long int want=threads*BUCKETS_PER_THREAD*OVERSAMPLE;
+    std::vector<long int> sample;
+    sample.reserve(want);
+    unsigned long long seed=0x9E3779B97F4A7C15ull;
+    for (long int i=0; i<want; i++){
+        seed=seed*6364136223846793005ull+1442695040888963407ull;
+        sample.push_back((long int)((seed>>17)%n));
+    }
+    auto at=[&](long int x, long int y){ return comp(vector[x], vector[y]); };
+    quick_sort_inplace(sample, at);
+    std::vector<long int> splitters;
+    for (long int i=OVERSAMPLE; i<want; i+=OVERSAMPLE)
+        if (splitters.empty() || at(splitters.back(), sample[i]))
+            splitters.push_back(sample[i]);
+
+    //bucket 2i holds keys in (splitter[i-1], splitter[i]), 2i+1 holds keys equal to splitter[i]
+    long int ns=(long int)splitters.size(), buckets=2*ns+1;
+    std::vector<uint32_t> bucket(n);
+    std::vector<long int> hist(threads*buckets, 0);
+    long int block=(n+threads-1)/threads;
+    run(threads, [&](unsigned int t){
+        long int *h=&hist[t*buckets];
+        long int end=(t+1)*block<n ? (t+1)*block : n;
+        for (long int i=t*block; i<end; i++){
+            long int lo=0, hi=ns;
+            while (lo<hi){
+                long int mid=(lo+hi)/2;
+                if (comp(vector[splitters[mid]], vector[i]))
+                    lo=mid+1;
+                else
+                    hi=mid;
+            }
+            uint32_t b=(uint32_t)(2*lo+(lo<ns && !comp(vector[i], vector[splitters[lo]])));
+            bucket[i]=b;
+            h[b]++;
+        }
+    });
+
+    //bucket b of thread t starts after all smaller buckets and after b of threads before t
+    std::vector<long int> start(buckets+1, 0);
+    for (long int b=0, sum=0; b<buckets; b++){
+        start[b]=sum;
+        for (unsigned int t=0; t<threads; t++){
+            long int c=hist[t*buckets+b];
+            hist[t*buckets+b]=sum;
+            sum+=c;
+        }
+    }
+    start[buckets]=n;
+
+    sort_allocation(comp, n*sizeof(T));
+    std::vector<T> out(n);
+    run(threads, [&](unsigned int t){
+        long int *offset=&hist[t*buckets];
+        long int end=(t+1)*block<n ? (t+1)*block : n;
+        for (long int i=t*block; i<end; i++)
+            out[offset[bucket[i]]++]=std::move(vector[i]);
+    });
+
+    std::atomic<long int> next(0);
+    run(threads, [&](unsigned int){
+        for (long int b=next.fetch_add(2); b<buckets; b=next.fetch_add(2)){
+            long int left=start[b], right=start[b+1]-1;
+            if (right>left)
+                introsort_helper(out.begin(), left, right, introsort_depth(right-left+1), comp);
+        }
+    });
+    vector.swap(out);
+}
+
+template<typename T, typename Compare = std::less<T>>
+void parallel_sort(std::vector<T> &vector, Compare comp = Compare(),
+    unsigned int threads = std::thread::hardware_concurrency()) {
+    sample_sort_helper(vector, comp, threads, [](unsigned int count, auto body){
+        run_threads(count, body);
+    });
+}
+
+template<typename T, typename Compare>
+void parallel_sort(std::vector<T> &vector, Compare comp, ThreadPool &pool) {
+    //the caller's thread joins in, so one more slice than workers
+    sample_sort_helper(vector, comp, pool.size()+1, [&pool](unsigned int count, auto body){
+        run_threads(pool, count, body);
+    });
+}
+
+//pieces below this size are merged or sorted sequentially
+const long int PARALLEL_MERGE_CUTOFF=1<<14;
+
+/**
+ * Co-rank: number of elements a[alo, ahi) contributes to the first k
+ * outputs of the stable merge of a[alo, ahi) and b[blo, bhi), where
+ * a wins ties. Splitting both inputs at the same rank lets independent
+ * tasks merge disjoint pieces of the output.
+ * Time complexity: O(log k)
+ */
+template<typename T, typename Compare>
+long int co_rank(long int k, const std::vector<T> &a, long int alo, long int ahi,
+    const std::vector<T> &b, long int blo, long int bhi, Compare comp){
+    long int la=ahi-alo, lb=bhi-blo;
+    long int lo=k-lb>0 ? k-lb : 0, hi=k<la ? k : la;
+    while (lo<hi){
+        long int i=lo+(hi-lo)/2, j=k-i;
+        //a[i] has to come before b[j-1], so the a side needs more
+        if (j>0 && !comp(b[blo+j-1], a[alo+i]))
+            lo=i+1;
+        else
+            hi=i;
+    }
+    return lo;
+}
+
+/**
+ * Stable merge of src[lo, mid) and src[mid, hi) into dst[lo, hi), cut
+ * into pieces by co-ranking and merged as tasks on the pool.
+ */
+template<typename T, typename Compare>
+void parallel_merge(std::vector<T> &src, std::vector<T> &dst, long int lo, long int mid, long int hi,
+    Compare comp, ThreadPool &pool){
+    long int pieces=(hi-lo)/PARALLEL_MERGE_CUTOFF;
+    if (pieces>4*(long int)pool.size())
+        pieces=4*(long int)pool.size();
+    if (pieces<2){
+        merge_runs(src.begin(), dst.begin(), lo, mid, hi, comp);
+        return ;
+    }
+    //all cuts are taken before any piece starts moving elements out of src
+    std::vector<long int> cut(pieces+1);
+    for (long int p=0; p<=pieces; p++)
+        cut[p]=lo+co_rank((hi-lo)*p/pieces, src, lo, mid, src, mid, hi, comp);
+    TaskGroup group(pool);
+    for (long int p=0; p<pieces; p++){
+        group.run([&, p]{
+            long int k0=(hi-lo)*p/pieces, k1=(hi-lo)*(p+1)/pieces;
+            long int i=cut[p], iend=cut[p+1];
+            long int j=mid+k0-(i-lo), jend=mid+k1-(iend-lo);
+            long int k=lo+k0;
+            while (i<iend && j<jend){
+                if (comp(src[j], src[i]))
+                    dst[k++]=std::move(src[j++]);
+                else
+                    dst[k++]=std::move(src[i++]);
+            }
+            while (i<iend)
+                dst[k++]=std::move(src[i++]);
+            while (j<jend)
+                dst[k++]=std::move(src[j++]);
+        });
+    }
+    group.wait();
+}
+
+/**
+ * Stably sort a[lo, hi), leaving the result in b if into_b is set and in
+ * a otherwise. Both ranges are used as scratch. The halves are sorted
+ * into the opposite array as forked tasks, then merged in parallel.
+ */
+template<typename T, typename Compare>
+void pms_helper(std::vector<T> &a, std::vector<T> &b, long int lo, long int hi, bool into_b,
+    Compare comp, ThreadPool &pool){
+    if (hi-lo<=PARALLEL_MERGE_CUTOFF){
+        bool in_b=false;
+        std::vector<long int> runs=collect_runs(a.begin(), lo, hi, comp);
+        if (runs.size()>2)
+            in_b=merge_passes(a.begin(), b.begin(), runs, comp);
+        if (in_b!=into_b){
+            std::vector<T> &from=in_b ? b : a, &to=in_b ? a : b;
+            for (long int i=lo; i<hi; i++)
+                to[i]=std::move(from[i]);
+        }
+        return ;
+    }
+    long int mid=lo+(hi-lo)/2;
+    {
+        TaskGroup group(pool);
+        group.run([&]{ pms_helper(a, b, lo, mid, !into_b, comp, pool); });
+        pms_helper(a, b, mid, hi, !into_b, comp, pool);
+        group.wait();
+    }
+    SortTimer<Compare> timer(comp, SORT_PHASE_MERGE);
+    if (into_b)
+        parallel_merge(a, b, lo, mid, hi, comp, pool);
+    else
+        parallel_merge(b, a, lo, mid, hi, comp, pool);
+}
+
+/**
+ * Stable parallel merge sort on a shared work-stealing pool.
+ * Halves are forked recursively down to PARALLEL_MERGE_CUTOFF, where the
+ * sequential natural merge sort takes over; every merge above that is
+ * itself split by co-ranking, so the top levels do not serialize.
+ * Time complexity: O(n log n / threads + log^2 n), O(n) extra space
+ */
+template<typename T, typename Compare>
+void parallel_merge_sort(std::vector<T> &vector, Compare comp, ThreadPool &pool) {
+    long int n=(long int)vector.size();
+    if (n<=PARALLEL_MERGE_CUTOFF){
+        merge_sort(vector, comp);
+        return ;
+    }
+    sort_allocation(comp, n*sizeof(T));
+    std::vector<T> buffer(std::make_move_iterator(vector.begin()), std::make_move_iterator(vector.end()));
+    pms_helper(buffer, vector, 0, n, true, comp, pool);
+}
+
+template<typename T, typename Compare = std::less<T>>
+void parallel_merge_sort(std::vector<T> &vector, Compare comp = Compare(),
+    unsigned int threads = std::thread::hardware_concurrency()) {
+    ThreadPool pool(threads);
+    parallel_merge_sort(vector, comp, pool);
+}
+
+#endif //VE281P1_PARALLEL_SORT_HPP
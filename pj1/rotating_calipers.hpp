@@ -0,0 +1,158 @@
+#ifndef VE281P1_ROTATING_CALIPERS_HPP
+#define VE281P1_ROTATING_CALIPERS_HPP
+
+#include "orientation.hpp"
+
+#include <cmath>
+#include <vector>
+
+/**
+ * Rotating calipers on a hull in the form the algorithms of
+ * convex_hull.hpp return (counter-clockwise from p0, without collinear
+ * points). Each routine turns a caliper along every edge of the hull in
+ * order, while the pointers to the opposite and side vertices only move
+ * forward, so one pass is O(h). Predicates are exact in 128 bits; lengths
+ * and areas are computed in long double and returned as double.
+ */
+
+//the two vertices farthest apart
+struct HullDiameter {
+    long int first, second;
+    double length;
+};
+
+//the hull lies between the line through edge (hull[edge], hull[edge+1]) and its parallel through hull[vertex]
+struct HullWidth {
+    long int edge, vertex;
+    double width;
+};
+
+//the smallest rectangle around the hull, corners counter-clockwise, the first side along edge
+struct HullRectangle {
+    long int edge;
+    double area;
+    double x[4], y[4];
+};
+
+//cross and dot products of b-a and d-c
+inline __int128 caliper_cross(const point &a, const point &b, const point &c, const point &d){
+    return (__int128)(b.x-a.x)*(d.y-c.y)-(__int128)(b.y-a.y)*(d.x-c.x);
+}
+
+inline __int128 caliper_dot(const point &a, const point &b, const point &c, const point &d){
+    return (__int128)(b.x-a.x)*(d.x-c.x)+(__int128)(b.y-a.y)*(d.y-c.y);
+}
+
+/**
+ * Move j forward to the vertex farthest from the line of edge i, the
+ * first one if an edge there is parallel to edge i
+ */
+inline long int antipodal(const std::vector<point> &hull, long int i, long int j){
+    long int h=(long int)hull.size(), i1=(i+1)%h;
+    while (caliper_cross(hull[i], hull[i1], hull[j], hull[(j+1)%h])>0)
+        j=(j+1)%h;
+    return j;
+}
+
+/**
+ * Every vertex farthest from some point of the hull is antipodal to an
+ * end of some edge, so only those pairs are measured.
+ * Time complexity: O(h)
+ */
+inline HullDiameter hull_diameter(const std::vector<point> &hull){
+    long int h=(long int)hull.size();
+    HullDiameter best={0, 0, 0};
+    __int128 bestSquared=0;
+    if (h<2)
+        return best;
+    for (long int i=0, j=1; i<h; i++){
+        j=antipodal(hull, i, j);
+        for (long int a: {i, (i+1)%h}){
+            __int128 squared=caliper_dot(hull[a], hull[j], hull[a], hull[j]);
+            if (squared>bestSquared){
+                bestSquared=squared;
+                best={a, j, 0};
+            }
+        }
+    }
+    best.length=(double)std::sqrt((long double)bestSquared);
+    return best;
+}
+
+/**
+ * The narrowest pair of parallel lines around a convex polygon has one
+ * of them through an edge, so the width is the least distance between an
+ * edge and its antipodal vertex.
+ * Time complexity: O(h)
+ */
+inline HullWidth hull_width(const std::vector<point> &hull){
+    long int h=(long int)hull.size();
+    HullWidth best={0, 0, 0};
+    if (h<3)
+        return best;
+    for (long int i=0, j=1; i<h; i++){
+        long int i1=(i+1)%h;
+        j=antipodal(hull, i, j);
+        long double width=(long double)caliper_cross(hull[i], hull[i1], hull[i], hull[j])
+            /std::sqrt((long double)caliper_dot(hull[i], hull[i1], hull[i], hull[i1]));
+        if (i==0 || width<best.width)
+            best={i, j, (double)width};
+    }
+    return best;
+}
+
+/**
+ * The minimum-area enclosing rectangle has a side along an edge of the
+ * hull (Freeman and Shapira). For every edge the extreme vertices ahead,
+ * opposite and behind it are followed by three calipers.
+ * Time complexity: O(h)
+ */
+inline HullRectangle hull_min_rectangle(const std::vector<point> &hull){
+    long int h=(long int)hull.size();
+    HullRectangle best={0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}};
+    if (h==0)
+        return best;
+    if (h==1){
+        for (int c=0; c<4; c++){
+            best.x[c]=(double)hull[0].x;
+            best.y[c]=(double)hull[0].y;
+        }
+        return best;
+    }
+    long double bestArea=0;
+    for (long int i=0, ahead=0, top=0, behind=0; i<h; i++){
+        const point &a=hull[i], &b=hull[(i+1)%h];
+        while (caliper_dot(a, b, hull[ahead], hull[(ahead+1)%h])>0)
+            ahead=(ahead+1)%h;
+        if (i==0)
+            top=ahead;
+        top=antipodal(hull, i, top);
+        if (i==0)
+            behind=top;
+        while (caliper_dot(a, b, hull[behind], hull[(behind+1)%h])<0)
+            behind=(behind+1)%h;
+
+        long double squared=(long double)caliper_dot(a, b, a, b);
+        long double length=(long double)caliper_dot(a, b, hull[behind], hull[ahead]);
+        long double height=(long double)caliper_cross(a, b, a, hull[top]);
+        long double area=length*height/squared;
+        if (i>0 && area>=bestArea)
+            continue;
+        bestArea=area;
+        //a + u*s spans the side along the edge, n*height/|ab| goes up to the opposite side
+        long double ux=(long double)(b.x-a.x), uy=(long double)(b.y-a.y);
+        long double from=(long double)caliper_dot(a, b, a, hull[behind])/squared;
+        long double to=(long double)caliper_dot(a, b, a, hull[ahead])/squared;
+        long double up=height/squared;
+        long double s[4]={from, to, to, from}, t[4]={0, 0, up, up};
+        best.edge=i;
+        best.area=(double)area;
+        for (int c=0; c<4; c++){
+            best.x[c]=(double)(a.x+ux*s[c]-uy*t[c]);
+            best.y[c]=(double)(a.y+uy*s[c]+ux*t[c]);
+        }
+    }
+    return best;
+}
+
+#endif //VE281P1_ROTATING_CALIPERS_HPP
@@ -0,0 +1,424 @@
+#include "sort.hpp"
+#include "parallel_sort.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+using namespace std;
+
+/**
+ * Benchmark of every algorithm in sort.hpp and parallel_sort.hpp.
+ *
+ *   sort_bench [--sizes 10,1000,...] [--types int,double,string,record]
+ *              [--dists random,sorted,...] [--algos merge,auto,...]
+ *              [--repeat 3] [--quadratic-max 10000] [--no-count]
+ *              [--out results.json] [--compare baseline.json] [--threshold 0.1]
+ *
+ * Every (algorithm, type, distribution, size) is timed best-of-repeat and
+ * reported as one JSON object per line inside an array: ns per element,
+ * comparisons (from a separate instrumented run, null where the
+ * algorithm does not compare) and peak heap bytes on top of the input.
+ * With --compare the results are checked against a saved run, and any
+ * time or comparison count that grew by more than the threshold is
+ * reported; the exit status is then 1.
+ */
+
+//heap accounting for the peak memory column, in usable bytes of every block
+static atomic<long int> heap_current(0), heap_peak(0);
+
+void *operator new(size_t size){
+    void *data=malloc(size>0 ? size : 1);
+    if (!data)
+        throw bad_alloc();
+    long int bytes=(long int)malloc_usable_size(data);
+    long int now=heap_current.fetch_add(bytes)+bytes, peak=heap_peak.load();
+    while (now>peak && !heap_peak.compare_exchange_weak(peak, now))
+        ;
+    return data;
+}
+
+//kept out of line, or gcc sees free() on a pointer from operator new and warns
+__attribute__((noinline)) void operator delete(void *data) noexcept {
+    if (!data)
+        return ;
+    heap_current.fetch_sub((long int)malloc_usable_size(data));
+    free(data);
+}
+
+void *operator new[](size_t size){ return operator new(size); }
+void operator delete[](void *data) noexcept { operator delete(data); }
+void operator delete(void *data, size_t) noexcept { operator delete(data); }
+void operator delete[](void *data, size_t) noexcept { operator delete(data); }
+
+struct Record {
+    uint64_t key;
+    char payload[56];
+
+    bool operator<(const Record &other) const { return key<other.key; }
+};
+
+uint64_t bench_key(int x){ return (uint64_t)x; }
+uint64_t bench_key(double x){ return (uint64_t)x; }
+uint64_t bench_key(const Record &x){ return x.key; }
+
+template<typename T> T make_element(uint64_t v);
+template<> int make_element<int>(uint64_t v){ return (int)v; }
+template<> double make_element<double>(uint64_t v){ return (double)v+0.5; }
+template<> string make_element<string>(uint64_t v){
+    //zero padded, so string order matches the order of v
+    char text[24];
+    snprintf(text, sizeof(text), "%020llu", (unsigned long long)v);
+    return text;
+}
+template<> Record make_element<Record>(uint64_t v){
+    Record r;
+    r.key=v;
+    memset(r.payload, (int)(v&0xff), sizeof(r.payload));
+    return r;
+}
+
+const char *const DISTRIBUTIONS[]={"random", "sorted", "reversed", "organ", "few", "sawtooth", "zipf"};
+const char *const TYPES[]={"int", "double", "string", "record"};
+const char *const ALGORITHMS[]={"bubble", "insertion", "selection", "merge", "block_merge", "quick_extra", "quick_inplace",
+    "radix", "radix_msd", "sort_by_key", "auto", "parallel", "parallel_merge", "std"};
+
+//keys of the distribution, all below 2^31 so every element type can hold them
+vector<uint64_t> make_keys(const string &dist, long int n, mt19937_64 &rng){
+    vector<uint64_t> keys(n);
+    const uint64_t RANGE=1ull<<31;
+    if (dist=="random")
+        for (auto &k: keys)
+            k=rng()%RANGE;
+    else if (dist=="sorted")
+        for (long int i=0; i<n; i++)
+            keys[i]=i;
+    else if (dist=="reversed")
+        for (long int i=0; i<n; i++)
+            keys[i]=n-i;
+    else if (dist=="organ")
+        for (long int i=0; i<n; i++)
+            keys[i]=i<n/2 ? i : n-i;
+    else if (dist=="few")
+        for (auto &k: keys)
+            k=rng()%16;
+    else if (dist=="sawtooth"){
+        //16 ascending teeth
+        long int period=n/16>1 ? n/16 : 1;
+        for (long int i=0; i<n; i++)
+            keys[i]=i%period;
+    }
+    else if (dist=="zipf"){
+        //rank r drawn with probability proportional to 1/r
+        long int ranks=n<(1<<20) ? n : (1<<20);
+        vector<double> cdf(ranks);
+        double sum=0;
+        for (long int r=0; r<ranks; r++)
+            cdf[r]=(sum+=1.0/(r+1));
+        uniform_real_distribution<double> u(0, sum);
+        for (auto &k: keys)
+            k=lower_bound(cdf.begin(), cdf.end(), u(rng))-cdf.begin();
+    }
+    else{
+        cerr<<"unknown distribution "<<dist<<endl;
+        exit(2);
+    }
+    return keys;
+}
+
+/**
+ * Sort v with the named algorithm
+ * @return false if the algorithm does not apply to T
+ */
+template<typename T, typename Compare>
+bool run_algorithm(const string &algo, vector<T> &v, Compare comp, ThreadPool &pool){
+    if (algo=="bubble")
+        bubble_sort(v, comp);
+    else if (algo=="insertion")
+        insertion_sort(v, comp);
+    else if (algo=="selection")
+        selection_sort(v, comp);
+    else if (algo=="merge")
+        merge_sort(v, comp);
+    else if (algo=="block_merge")
+        block_merge_sort(v, comp);
+    else if (algo=="quick_extra")
+        quick_sort_extra(v, comp);
+    else if (algo=="quick_inplace")
+        quick_sort_inplace(v, comp);
+    else if (algo=="radix" || algo=="radix_msd"){
+        if constexpr (is_same<T, string>::value)
+            return false;
+        else if (algo=="radix"){
+            //numbers are their own keys
+            if constexpr (is_arithmetic<T>::value)
+                radix_sort(v);
+            else
+                radix_sort(v, [](const T &x){ return bench_key(x); });
+        }
+        else
+            radix_sort_msd(v, [](const T &x){ return bench_key(x); });
+    }
+    else if (algo=="sort_by_key"){
+        if constexpr (is_same<T, string>::value)
+            return false;
+        else
+            sort_by_key(v, [](const T &x){ return bench_key(x); });
+    }
+    else if (algo=="auto")
+        auto_sort(v, comp);
+    else if (algo=="parallel")
+        parallel_sort(v, comp, pool);
+    else if (algo=="parallel_merge")
+        parallel_merge_sort(v, comp, pool);
+    else if (algo=="std")
+        sort(v.begin(), v.end(), comp);
+    else{
+        cerr<<"unknown algorithm "<<algo<<endl;
+        exit(2);
+    }
+    return true;
+}
+
+//algorithms whose comparisons are not counted: key based, or outside sort.hpp
+bool counts_comparisons(const string &algo){
+    return algo!="radix" && algo!="radix_msd" && algo!="sort_by_key";
+}
+
+bool quadratic(const string &algo){
+    return algo=="bubble" || algo=="insertion" || algo=="selection";
+}
+
+struct Options {
+    vector<long int> sizes;
+    vector<string> types, dists, algos;
+    int repeat;
+    long int quadratic_max;
+    bool count;
+    string out, compare;
+    double threshold;
+};
+
+struct Result {
+    string algo, type, dist;
+    long int n;
+    double ns;
+    long int comparisons, peak;
+};
+
+template<typename T>
+void bench_type(const Options &opt, const string &type, ThreadPool &pool, vector<Result> &results){
+    mt19937_64 rng(281);
+    for (auto &dist: opt.dists){
+        for (long int n: opt.sizes){
+            vector<uint64_t> keys=make_keys(dist, n, rng);
+            vector<T> input;
+            input.reserve(n);
+            for (auto k: keys)
+                input.push_back(make_element<T>(k));
+            keys=vector<uint64_t>();
+            for (auto &algo: opt.algos){
+                if (quadratic(algo) && n>opt.quadratic_max)
+                    continue;
+                Result r={algo, type, dist, n, 1e300, -1, 0};
+                bool applies=true;
+                for (int rep=0; rep<opt.repeat && applies; rep++){
+                    vector<T> v=input;
+                    long int base=heap_current.load();
+                    heap_peak=base;
+                    auto start=chrono::steady_clock::now();
+                    applies=run_algorithm(algo, v, less<T>(), pool);
+                    chrono::duration<double, nano> took=chrono::steady_clock::now()-start;
+                    r.ns=min(r.ns, took.count()/n);
+                    r.peak=max(r.peak, heap_peak.load()-base);
+                    if (applies && !is_sorted(v.begin(), v.end())){
+                        cerr<<algo<<" failed to sort "<<type<<" "<<dist<<" n="<<n<<endl;
+                        exit(3);
+                    }
+                }
+                if (!applies)
+                    continue;
+                if (opt.count && counts_comparisons(algo)){
+                    SortStats stats;
+                    vector<T> v=input;
+                    run_algorithm(algo, v, instrument(less<T>(), stats), pool);
+                    r.comparisons=stats.comparisons.load();
+                }
+                cerr<<algo<<" "<<type<<" "<<dist<<" n="<<n<<": "<<r.ns<<" ns/elem"<<endl;
+                results.push_back(r);
+            }
+        }
+    }
+}
+
+string to_json(const Result &r){
+    ostringstream out;
+    out<<"{\"algorithm\": \""<<r.algo<<"\", \"type\": \""<<r.type<<"\", \"distribution\": \""<<r.dist
+        <<"\", \"n\": "<<r.n<<", \"ns_per_element\": "<<r.ns<<", \"comparisons\": ";
+    if (r.comparisons<0)
+        out<<"null";
+    else
+        out<<r.comparisons;
+    out<<", \"peak_bytes\": "<<r.peak<<"}";
+    return out.str();
+}
+
+//value of "field": in a line written by to_json
+string json_field(const string &line, const string &field){
+    size_t at=line.find("\""+field+"\": ");
+    if (at==string::npos)
+        return "";
+    at+=field.size()+4;
+    if (line[at]=='"')
+        return line.substr(at+1, line.find('"', at+1)-at-1);
+    return line.substr(at, line.find_first_of(",}", at)-at);
+}
+
+/**
+ * Report results that got slower or compare more than a saved run
+ * @return number of regressions
+ */
+int compare_results(const vector<Result> &results, const string &path, double threshold){
+    ifstream in(path);
+    if (!in){
+        cerr<<"cannot read baseline "<<path<<endl;
+        exit(2);
+    }
+    map<string, Result> baseline;
+    string line;
+    while (getline(in, line)){
+        if (line.find("\"algorithm\"")==string::npos)
+            continue;
+        Result r;
+        r.algo=json_field(line, "algorithm");
+        r.type=json_field(line, "type");
+        r.dist=json_field(line, "distribution");
+        r.n=atol(json_field(line, "n").c_str());
+        r.ns=atof(json_field(line, "ns_per_element").c_str());
+        string c=json_field(line, "comparisons");
+        r.comparisons=c=="null" ? -1 : atol(c.c_str());
+        r.peak=atol(json_field(line, "peak_bytes").c_str());
+        baseline[r.algo+" "+r.type+" "+r.dist+" n="+to_string(r.n)]=r;
+    }
+    int regressions=0;
+    for (auto &r: results){
+        string key=r.algo+" "+r.type+" "+r.dist+" n="+to_string(r.n);
+        auto found=baseline.find(key);
+        if (found==baseline.end())
+            continue;
+        const Result &b=found->second;
+        if (r.ns>b.ns*(1+threshold)){
+            cerr<<"REGRESSION time "<<key<<": "<<b.ns<<" -> "<<r.ns<<" ns/elem"<<endl;
+            regressions++;
+        }
+        if (b.comparisons>=0 && r.comparisons>b.comparisons*(1+threshold)){
+            cerr<<"REGRESSION comparisons "<<key<<": "<<b.comparisons<<" -> "<<r.comparisons<<endl;
+            regressions++;
+        }
+        if (r.peak>b.peak*(1+threshold)+4096){
+            cerr<<"REGRESSION memory "<<key<<": "<<b.peak<<" -> "<<r.peak<<" bytes"<<endl;
+            regressions++;
+        }
+    }
+    cerr<<regressions<<" regression(s) against "<<path<<endl;
+    return regressions;
+}
+
+vector<string> split(const string &list){
+    vector<string> items;
+    string item;
+    istringstream in(list);
+    while (getline(in, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+int main(int argc, char **argv){
+    Options opt;
+    opt.sizes={10, 1000, 100000, 1000000};
+    opt.types.assign(begin(TYPES), end(TYPES));
+    opt.dists.assign(begin(DISTRIBUTIONS), end(DISTRIBUTIONS));
+    opt.algos.assign(begin(ALGORITHMS), end(ALGORITHMS));
+    opt.repeat=3;
+    opt.quadratic_max=10000;
+    opt.count=true;
+    opt.threshold=0.1;
+    for (int i=1; i<argc; i++){
+        string arg=argv[i];
+        bool has_value=i+1<argc;
+        if (arg=="--sizes" && has_value){
+            opt.sizes.clear();
+            for (auto &s: split(argv[++i]))
+                opt.sizes.push_back((long int)atof(s.c_str()));
+        }
+        else if (arg=="--types" && has_value)
+            opt.types=split(argv[++i]);
+        else if (arg=="--dists" && has_value)
+            opt.dists=split(argv[++i]);
+        else if (arg=="--algos" && has_value)
+            opt.algos=split(argv[++i]);
+        else if (arg=="--repeat" && has_value)
+            opt.repeat=atoi(argv[++i]);
+        else if (arg=="--quadratic-max" && has_value)
+            opt.quadratic_max=(long int)atof(argv[++i]);
+        else if (arg=="--no-count")
+            opt.count=false;
+        else if (arg=="--out" && has_value)
+            opt.out=argv[++i];
+        else if (arg=="--compare" && has_value)
+            opt.compare=argv[++i];
+        else if (arg=="--threshold" && has_value)
+            opt.threshold=atof(argv[++i]);
+        else{
+            cerr<<"usage: "<<argv[0]<<" [--sizes 10,1e3,1e6] [--types int,double,string,record]"
+                <<" [--dists random,sorted,reversed,organ,few,sawtooth,zipf] [--algos merge,auto,...]"
+                <<" [--repeat 3] [--quadratic-max 1e4] [--no-count] [--out file.json]"
+                <<" [--compare baseline.json] [--threshold 0.1]"<<endl;
+            return 2;
+        }
+    }
+
+    ThreadPool pool;
+    vector<Result> results;
+    for (auto &type: opt.types){
+        if (type=="int")
+            bench_type<int>(opt, type, pool, results);
+        else if (type=="double")
+            bench_type<double>(opt, type, pool, results);
+        else if (type=="string")
+            bench_type<string>(opt, type, pool, results);
+        else if (type=="record")
+            bench_type<Record>(opt, type, pool, results);
+        else{
+            cerr<<"unknown type "<<type<<endl;
+            return 2;
+        }
+    }
+
+    ofstream file;
+    if (!opt.out.empty())
+        file.open(opt.out);
+    ostream &out=opt.out.empty() ? cout : file;
+    out<<"["<<endl;
+    for (size_t i=0; i<results.size(); i++)
+        out<<"  "<<to_json(results[i])<<(i+1<results.size() ? "," : "")<<endl;
+    out<<"]"<<endl;
+
+    if (!opt.compare.empty() && compare_results(results, opt.compare, opt.threshold)>0)
+        return 1;
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include "sort.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+using namespace std;
+
+//elements sorted per measurement, spread over as many copies as needed
+const long int CALIBRATE_ELEMENTS=1<<20;
+const int CALIBRATE_REPEAT=5;
+
+//a comparator the sorting networks do not recognize, like most user comparators
+struct PlainLess {
+    bool operator()(double a, double b) const { return a<b; }
+};
+
+/**
+ * Best of CALIBRATE_REPEAT timings of sorter over CALIBRATE_ELEMENTS/n
+ * copies of input, in nanoseconds per element.
+ */
+template<typename T, typename Sorter>
+double time_sort(const vector<T> &input, Sorter sorter){
+    long int n=(long int)input.size(), copies=CALIBRATE_ELEMENTS/n>1 ? CALIBRATE_ELEMENTS/n : 1;
+    double best=1e300;
+    for (int r=0; r<CALIBRATE_REPEAT; r++){
+        vector<T> data;
+        data.reserve(copies*n);
+        for (long int c=0; c<copies; c++)
+            data.insert(data.end(), input.begin(), input.end());
+        auto start=chrono::steady_clock::now();
+        for (long int c=0; c<copies; c++)
+            sorter(data.begin()+c*n, data.begin()+(c+1)*n);
+        chrono::duration<double, nano> took=chrono::steady_clock::now()-start;
+        if (took.count()/(copies*n)<best)
+            best=took.count()/(copies*n);
+    }
+    return best;
+}
+
+template<typename T>
+vector<T> random_input(long int n, mt19937_64 &rng){
+    vector<T> v(n);
+    for (auto &x: v)
+        x=(T)(rng()>>1);
+    return v;
+}
+
+//largest n at which insertion sort still beats the introsort
+long int insertion_max(mt19937_64 &rng){
+    long int best=2;
+    for (long int n=4; n<=512; n+=n/4>4 ? n/4 : 4){
+        vector<double> v=random_input<double>(n, rng);
+        double ins=time_sort(v, [](auto f, auto l){ insertion_sort(f, l, PlainLess()); });
+        double qs=time_sort(v, [](auto f, auto l){ quick_sort_inplace(f, l, PlainLess()); });
+        fprintf(stderr, "insertion  n=%-6ld insertion %.2f introsort %.2f ns/elem\n", n, ins, qs);
+        if (ins>qs)
+            break;
+        best=n;
+    }
+    return best;
+}
+
+long int count_inversions(const vector<double> &v){
+    long int count=0;
+    for (long int i=0; i<(long int)v.size(); i++)
+        for (long int j=i+1; j<(long int)v.size(); j++)
+            count+=v[j]<v[i];
+    return count;
+}
+
+//inversions per element up to which insertion sort beats the introsort at AUTO_NEARLY_SORTED_MAX
+long int insertion_inversions(mt19937_64 &rng){
+    long int n=AUTO_NEARLY_SORTED_MAX, best=0;
+    for (long int w=2; w<=n; w*=2){
+        //shuffling inside windows of w leaves about w/4 inversions per element
+        vector<double> v(n);
+        for (long int i=0; i<n; i++)
+            v[i]=(double)i;
+        for (long int i=0; i<n; i+=w)
+            shuffle(v.begin()+i, v.begin()+(i+w<n ? i+w : n), rng);
+        long int q=count_inversions(v)/n;
+        double ins=time_sort(v, [](auto f, auto l){ insertion_sort(f, l, PlainLess()); });
+        double qs=time_sort(v, [](auto f, auto l){ quick_sort_inplace(f, l, PlainLess()); });
+        fprintf(stderr, "inversions q=%-6ld insertion %.2f introsort %.2f ns/elem\n", q, ins, qs);
+        if (ins>qs)
+            break;
+        best=q;
+    }
+    return best;
+}
+
+//largest exponent e (in percent) such that n^e presorted runs are still faster to merge than to introsort
+long int merge_runs_exponent(mt19937_64 &rng){
+    long int n=1<<18, best=0;
+    for (long int runs=2; runs<n; runs*=2){
+        vector<double> v=random_input<double>(n, rng);
+        for (long int r=0; r<runs; r++)
+            quick_sort_inplace(v.begin()+n*r/runs, v.begin()+n*(r+1)/runs, PlainLess());
+        double ms=time_sort(v, [](auto f, auto l){ merge_sort(f, l, PlainLess()); });
+        double qs=time_sort(v, [](auto f, auto l){ quick_sort_inplace(f, l, PlainLess()); });
+        fprintf(stderr, "runs       r=%-6ld merge %.2f introsort %.2f ns/elem\n", runs, ms, qs);
+        if (ms>qs)
+            break;
+        best=(long int)(100*log2((double)runs)/log2((double)n));
+    }
+    return best;
+}
+
+//smallest n from which the radix sort beats the introsort on T
+template<typename T>
+long int radix_min(mt19937_64 &rng){
+    long int best=1<<30;
+    for (long int n=1<<16; n>=32; n/=2){
+        vector<T> v=random_input<T>(n, rng);
+        double rs=time_sort(v, [](auto f, auto l){ radix_sort(f, l); });
+        double qs=time_sort(v, [](auto f, auto l){ quick_sort_inplace(f, l); });
+        fprintf(stderr, "radix%-2d    n=%-6ld radix %.2f introsort %.2f ns/elem\n", (int)sizeof(T)*8, n, rs, qs);
+        if (rs>qs)
+            break;
+        best=n;
+    }
+    return best;
+}
+
+int main(){
+    mt19937_64 rng(281);
+    long int insertion=insertion_max(rng);
+    long int inversions=insertion_inversions(rng);
+    long int exponent=merge_runs_exponent(rng);
+    long int narrow=radix_min<int32_t>(rng);
+    long int wide=radix_min<int64_t>(rng);
+
+    printf("#ifndef VE281P1_SORT_TUNING_HPP\n");
+    printf("#define VE281P1_SORT_TUNING_HPP\n\n");
+    printf("//crossovers used by auto_sort, regenerate with: ./sort_calibrate > sort_tuning.hpp\n");
+    printf("const long int AUTO_INSERTION_MAX=%ld;\n", insertion);
+    printf("const long int AUTO_INSERTION_INVERSIONS=%ld;\n", inversions);
+    printf("const long int AUTO_MERGE_RUNS_EXPONENT=%ld;\n", exponent);
+    printf("const long int AUTO_RADIX_MIN_NARROW=%ld;\n", narrow);
+    printf("const long int AUTO_RADIX_MIN_WIDE=%ld;\n\n", wide);
+    printf("#endif //VE281P1_SORT_TUNING_HPP\n");
+}
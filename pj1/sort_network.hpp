@@ -0,0 +1,380 @@
+#ifndef VE281P1_SORT_NETWORK_HPP
+#define VE281P1_SORT_NETWORK_HPP
+
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Vectorized sorting networks for the leaves of the recursive sorts.
+ * Up to 8 registers of int32/int64/float/double are sorted with an
+ * in-register bitonic network and bitonic merges across registers, using
+ * AVX2 when the compiler targets it and SSE4 otherwise. Both lanes of a
+ * compare-exchange decide from the same total order, so that they never
+ * take the same input: floating point values are compared by their bits
+ * (see key), which orders -0 before +0 and NaN by sign and payload. Double
+ * needs the 64-bit compare of SSE4.2. Other element types, other
+ * comparators or a target without SSE4 select the scalar insertion sort
+ * at compile time (has_simd_network is false).
+ */
+
+#if defined(__AVX2__)
+
+struct net_i32 {
+    typedef int32_t T;
+    typedef __m256i reg;
+    static const int LANES=8;
+    static reg load(const T *p) { return _mm256_load_si256((const __m256i *)p); }
+    static void store(T *p, reg v) { _mm256_store_si256((__m256i *)p, v); }
+    static void minmax(reg a, reg b, reg &lo, reg &hi) {
+        lo=_mm256_min_epi32(a, b);
+        hi=_mm256_max_epi32(a, b);
+    }
+    static reg reverse(reg v) { return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)); }
+    template<int J> static reg partner(reg v) {
+        if constexpr (J==1) return _mm256_shuffle_epi32(v, 0xB1);
+        else if constexpr (J==2) return _mm256_shuffle_epi32(v, 0x4E);
+        else return _mm256_permute2x128_si256(v, v, 1);
+    }
+    template<int M> static reg blend(reg a, reg b) { return _mm256_blend_epi32(a, b, M); }
+};
+
+struct net_f32 {
+    typedef float T;
+    typedef __m256 reg;
+    static const int LANES=8;
+    static reg load(const T *p) { return _mm256_load_ps(p); }
+    static void store(T *p, reg v) { _mm256_store_ps(p, v); }
+    //bits as an integer, with the magnitude of negative values flipped: -NaN < -inf < -0 < +0 < +inf < +NaN
+    static __m256i key(reg v) {
+        __m256i bits=_mm256_castps_si256(v);
+        return _mm256_xor_si256(bits, _mm256_srli_epi32(_mm256_srai_epi32(bits, 31), 1));
+    }
+    static void minmax(reg a, reg b, reg &lo, reg &hi) {
+        reg swap=_mm256_castsi256_ps(_mm256_cmpgt_epi32(key(a), key(b)));
+        lo=_mm256_blendv_ps(a, b, swap);
+        hi=_mm256_blendv_ps(b, a, swap);
+    }
+    static reg reverse(reg v) { return _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)); }
+    template<int J> static reg partner(reg v) {
+        if constexpr (J==1) return _mm256_permute_ps(v, 0xB1);
+        else if constexpr (J==2) return _mm256_permute_ps(v, 0x4E);
+        else return _mm256_permute2f128_ps(v, v, 1);
+    }
+    template<int M> static reg blend(reg a, reg b) { return _mm256_blend_ps(a, b, M); }
+};
+
+struct net_i64 {
+    typedef int64_t T;
+    typedef __m256i reg;
+    static const int LANES=4;
+    static reg load(const T *p) { return _mm256_load_si256((const __m256i *)p); }
+    static void store(T *p, reg v) { _mm256_store_si256((__m256i *)p, v); }
+    static void minmax(reg a, reg b, reg &lo, reg &hi) {
+        reg greater=_mm256_cmpgt_epi64(a, b);
+        lo=_mm256_blendv_epi8(a, b, greater);
+        hi=_mm256_blendv_epi8(b, a, greater);
+    }
+    static reg reverse(reg v) { return _mm256_permute4x64_epi64(v, 0x1B); }
+    template<int J> static reg partner(reg v) {
+        if constexpr (J==1) return _mm256_shuffle_epi32(v, 0x4E);
+        else return _mm256_permute2x128_si256(v, v, 1);
+    }
+    //one mask bit per 64-bit lane, two per 32-bit blend lane
+    template<int M> static reg blend(reg a, reg b) {
+        return _mm256_blend_epi32(a, b, (M&1 ? 0x03 : 0)|(M&2 ? 0x0C : 0)|(M&4 ? 0x30 : 0)|(M&8 ? 0xC0 : 0));
+    }
+};
+
+struct net_f64 {
+    typedef double T;
+    typedef __m256d reg;
+    static const int LANES=4;
+    static reg load(const T *p) { return _mm256_load_pd(p); }
+    static void store(T *p, reg v) { _mm256_store_pd(p, v); }
+    //bits as an integer, with the magnitude of negative values flipped: -NaN < -inf < -0 < +0 < +inf < +NaN
+    static __m256i key(reg v) {
+        __m256i bits=_mm256_castpd_si256(v);
+        return _mm256_xor_si256(bits, _mm256_srli_epi64(_mm256_cmpgt_epi64(_mm256_setzero_si256(), bits), 1));
+    }
+    static void minmax(reg a, reg b, reg &lo, reg &hi) {
+        reg swap=_mm256_castsi256_pd(_mm256_cmpgt_epi64(key(a), key(b)));
+        lo=_mm256_blendv_pd(a, b, swap);
+        hi=_mm256_blendv_pd(b, a, swap);
+    }
+    static reg reverse(reg v) { return _mm256_permute4x64_pd(v, 0x1B); }
+    template<int J> static reg partner(reg v) {
+        if constexpr (J==1) return _mm256_permute_pd(v, 0x5);
+        else return _mm256_permute2f128_pd(v, v, 1);
+    }
+    template<int M> static reg blend(reg a, reg b) { return _mm256_blend_pd(a, b, M); }
+};
+
+#define VE281_SIMD_NETWORK 1
+#define VE281_SIMD_NETWORK_I64 1
+
+#elif defined(__SSE4_1__)
+
+struct net_i32 {
+    typedef int32_t T;
+    typedef __m128i reg;
+    static const int LANES=4;
+    static reg load(const T *p) { return _mm_load_si128((const __m128i *)p); }
+    static void store(T *p, reg v) { _mm_store_si128((__m128i *)p, v); }
+    static void minmax(reg a, reg b, reg &lo, reg &hi) {
+        lo=_mm_min_epi32(a, b);
+        hi=_mm_max_epi32(a, b);
+    }
+    static reg reverse(reg v) { return _mm_shuffle_epi32(v, 0x1B); }
+    template<int J> static reg partner(reg v) {
+        if constexpr (J==1) return _mm_shuffle_epi32(v, 0xB1);
+        else return _mm_shuffle_epi32(v, 0x4E);
+    }
+    //one mask bit per 32-bit lane, two per 16-bit blend lane
+    template<int M> static reg blend(reg a, reg b) {
+        return _mm_blend_epi16(a, b, (M&1 ? 0x03 : 0)|(M&2 ? 0x0C : 0)|(M&4 ? 0x30 : 0)|(M&8 ? 0xC0 : 0));
+    }
+};
+
+struct net_f32 {
+    typedef float T;
+    typedef __m128 reg;
+    static const int LANES=4;
+    static reg load(const T *p) { return _mm_load_ps(p); }
+    static void store(T *p, reg v) { _mm_store_ps(p, v); }
+    //bits as an integer, with the magnitude of negative values flipped: -NaN < -inf < -0 < +0 < +inf < +NaN
+    static __m128i key(reg v) {
+        __m128i bits=_mm_castps_si128(v);
+        return _mm_xor_si128(bits, _mm_srli_epi32(_mm_srai_epi32(bits, 31), 1));
+    }
+    static void minmax(reg a, reg b, reg &lo, reg &hi) {
+        reg swap=_mm_castsi128_ps(_mm_cmpgt_epi32(key(a), key(b)));
+        lo=_mm_blendv_ps(a, b, swap);
+        hi=_mm_blendv_ps(b, a, swap);
+    }
+    static reg reverse(reg v) { return _mm_shuffle_ps(v, v, 0x1B); }
+    template<int J> static reg partner(reg v) {
+        if constexpr (J==1) return _mm_shuffle_ps(v, v, 0xB1);
+        else return _mm_shuffle_ps(v, v, 0x4E);
+    }
+    template<int M> static reg blend(reg a, reg b) { return _mm_blend_ps(a, b, M); }
+};
+
+#if defined(__SSE4_2__)
+struct net_i64 {
+    typedef int64_t T;
+    typedef __m128i reg;
+    static const int LANES=2;
+    static reg load(const T *p) { return _mm_load_si128((const __m128i *)p); }
+    static void store(T *p, reg v) { _mm_store_si128((__m128i *)p, v); }
+    static void minmax(reg a, reg b, reg &lo, reg &hi) {
+        reg greater=_mm_cmpgt_epi64(a, b);
+        lo=_mm_blendv_epi8(a, b, greater);
+        hi=_mm_blendv_epi8(b, a, greater);
+    }
+    static reg reverse(reg v) { return _mm_shuffle_epi32(v, 0x4E); }
+    template<int J> static reg partner(reg v) { return _mm_shuffle_epi32(v, 0x4E); }
+    template<int M> static reg blend(reg a, reg b) { return _mm_blend_epi16(a, b, (M&1 ? 0x0F : 0)|(M&2 ? 0xF0 : 0)); }
+};
+
+struct net_f64 {
+    typedef double T;
+    typedef __m128d reg;
+    static const int LANES=2;
+    static reg load(const T *p) { return _mm_load_pd(p); }
+    static void store(T *p, reg v) { _mm_store_pd(p, v); }
+    //bits as an integer, with the magnitude of negative values flipped: -NaN < -inf < -0 < +0 < +inf < +NaN
+    static __m128i key(reg v) {
+        __m128i bits=_mm_castpd_si128(v);
+        return _mm_xor_si128(bits, _mm_srli_epi64(_mm_cmpgt_epi64(_mm_setzero_si128(), bits), 1));
+    }
+    static void minmax(reg a, reg b, reg &lo, reg &hi) {
+        reg swap=_mm_castsi128_pd(_mm_cmpgt_epi64(key(a), key(b)));
+        lo=_mm_blendv_pd(a, b, swap);
+        hi=_mm_blendv_pd(b, a, swap);
+    }
+    static reg reverse(reg v) { return _mm_shuffle_pd(v, v, 1); }
+    template<int J> static reg partner(reg v) { return _mm_shuffle_pd(v, v, 1); }
+    template<int M> static reg blend(reg a, reg b) { return _mm_blend_pd(a, b, M); }
+};
+#define VE281_SIMD_NETWORK_I64 1
+#endif
+
+#define VE281_SIMD_NETWORK 1
+
+#endif
+
+//registers a network sorts at most
+const int NETWORK_REGS=8;
+
+/**
+ * The traits above for T, or void when T has no vectorized network.
+ * Signed integers are matched by width, so int, long and long long
+ * all find a kernel.
+ */
+template<typename T, typename = void>
+struct network_traits { typedef void type; };
+
+#if defined(VE281_SIMD_NETWORK)
+template<typename T>
+struct network_traits<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value
+    && sizeof(T)==4>::type> { typedef net_i32 type; };
+template<> struct network_traits<float> { typedef net_f32 type; };
+#endif
+#if defined(VE281_SIMD_NETWORK_I64)
+template<typename T>
+struct network_traits<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value
+    && sizeof(T)==8>::type> { typedef net_i64 type; };
+template<> struct network_traits<double> { typedef net_f64 type; };
+#endif
+
+template<typename T, typename Compare>
+struct network_order { static const int value=0; };
+template<typename T> struct network_order<T, std::less<T>> { static const int value=1; };
+template<typename T> struct network_order<T, std::less<>> { static const int value=1; };
+template<typename T> struct network_order<T, std::greater<T>> { static const int value=-1; };
+template<typename T> struct network_order<T, std::greater<>> { static const int value=-1; };
+
+/**
+ * Whether network_sort can sort T under Compare
+ */
+template<typename T, typename Compare>
+struct has_simd_network : std::integral_constant<bool,
+    !std::is_void<typename network_traits<T>::type>::value && network_order<T, Compare>::value!=0> {};
+
+/**
+ * Largest range network_sort takes for T, 0 if it has no network
+ */
+template<typename T>
+constexpr long int network_capacity() {
+    if constexpr (std::is_void<typename network_traits<T>::type>::value)
+        return 0;
+    else
+        return NETWORK_REGS*network_traits<T>::type::LANES;
+}
+
+//compare-exchange lanes i and i^J, keeping the maximum where mask M is set
+template<typename V, int J, int M>
+inline typename V::reg network_stage(typename V::reg v){
+    typename V::reg p=V::template partner<J>(v), lo, hi;
+    V::minmax(v, p, lo, hi);
+    return V::template blend<M>(lo, hi);
+}
+
+//bitonic sort of the lanes of one register
+template<typename V>
+inline typename V::reg sort_register(typename V::reg v){
+    if constexpr (V::LANES==8){
+        v=network_stage<V, 1, 0x66>(v);
+        v=network_stage<V, 2, 0x3C>(v);
+        v=network_stage<V, 1, 0x5A>(v);
+        v=network_stage<V, 4, 0xF0>(v);
+        v=network_stage<V, 2, 0xCC>(v);
+        v=network_stage<V, 1, 0xAA>(v);
+    }
+    else if constexpr (V::LANES==4){
+        v=network_stage<V, 1, 0x6>(v);
+        v=network_stage<V, 2, 0xC>(v);
+        v=network_stage<V, 1, 0xA>(v);
+    }
+    else
+        v=network_stage<V, 1, 0x2>(v);
+    return v;
+}
+
+//sort the lanes of a register that holds a bitonic sequence
+template<typename V>
+inline typename V::reg merge_register(typename V::reg v){
+    if constexpr (V::LANES==8){
+        v=network_stage<V, 4, 0xF0>(v);
+        v=network_stage<V, 2, 0xCC>(v);
+        v=network_stage<V, 1, 0xAA>(v);
+    }
+    else if constexpr (V::LANES==4){
+        v=network_stage<V, 2, 0xC>(v);
+        v=network_stage<V, 1, 0xA>(v);
+    }
+    else
+        v=network_stage<V, 1, 0x2>(v);
+    return v;
+}
+
+//sort a bitonic sequence spread over n registers, n a power of two
+template<typename V>
+void merge_registers(typename V::reg *r, int n){
+    if (n==1){
+        r[0]=merge_register<V>(r[0]);
+        return ;
+    }
+    int half=n/2;
+    for (int i=0; i<half; i++)
+        V::minmax(r[i], r[i+half], r[i], r[i+half]);
+    merge_registers<V>(r, half);
+    merge_registers<V>(r+half, half);
+}
+
+//sort the lanes of n registers as one sequence, n a power of two
+template<typename V>
+void sort_registers(typename V::reg *r, int n){
+    if (n==1){
+        r[0]=sort_register<V>(r[0]);
+        return ;
+    }
+    int half=n/2;
+    sort_registers<V>(r, half);
+    sort_registers<V>(r+half, half);
+    //reverse the upper half so the whole sequence is bitonic
+    for (int i=0, j=n-1; i<half; i++, j--){
+        if (half+i>j)
+            break;
+        typename V::reg t=V::reverse(r[half+i]);
+        r[half+i]=V::reverse(r[j]);
+        r[j]=t;
+    }
+    merge_registers<V>(r, n);
+}
+
+/**
+ * Sort data[0, n) with the vectorized network, n<=network_capacity<T>().
+ * The range is padded to a power-of-two number of registers with the
+ * largest value of T, sorted ascending and written back in the order
+ * Compare asks for.
+ * Time complexity: O(n log^2 n) lane operations, no branches on the data
+ */
+template<typename T, typename Compare>
+void network_sort(T *data, long int n, Compare){
+    typedef typename network_traits<T>::type V;
+    typedef typename V::T U;
+    static_assert(sizeof(U)==sizeof(T), "network lane type must match the element");
+    alignas(32) U buf[NETWORK_REGS*V::LANES];
+    int regs=1;
+    while (regs*V::LANES<n)
+        regs*=2;
+    memcpy(buf, data, n*sizeof(T));
+    //the largest signed integer of the lane width is also the largest floating point key
+    typedef typename std::conditional<sizeof(U)==4, int32_t, int64_t>::type Bits;
+    const Bits top=std::numeric_limits<Bits>::max();
+    U pad;
+    memcpy(&pad, &top, sizeof(U));
+    for (long int i=n; i<regs*V::LANES; i++)
+        buf[i]=pad;
+    typename V::reg r[NETWORK_REGS];
+    for (int i=0; i<regs; i++)
+        r[i]=V::load(buf+i*V::LANES);
+    sort_registers<V>(r, regs);
+    for (int i=0; i<regs; i++)
+        V::store(buf+i*V::LANES, r[i]);
+    if (network_order<T, Compare>::value>0)
+        memcpy(data, buf, n*sizeof(T));
+    else
+        for (long int i=0; i<n; i++)
+            memcpy(data+i, buf+n-1-i, sizeof(T));
+}
+
+#endif //VE281P1_SORT_NETWORK_HPP
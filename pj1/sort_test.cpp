@@ -0,0 +1,446 @@
+#include "sort.hpp"
+#include "external_sort.hpp"
+#include "parallel_sort.hpp"
+#include "sort_instrument.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+using namespace std;
+
+/**
+ * Regression tests for sort.hpp, parallel_sort.hpp and external_sort.hpp.
+ *
+ *   sort_test
+ *
+ * Prints every check that fails; the exit status is 1 if any did. Build
+ * it for AVX2 (-mavx2) and for SSE4 alone (-msse4.2) to cover both sets
+ * of network kernels.
+ */
+
+static int failures=0;
+//the O(n^2) sorts only run up to this size
+const long int QUADRATIC_MAX=10000;
+
+void check(bool ok, const string &what){
+    if (ok)
+        return ;
+    printf("FAILED: %s\n", what.c_str());
+    failures++;
+}
+
+//bit patterns of a, sorted, so that -0, +0 and NaN payloads all count
+template<typename T>
+vector<string> bit_patterns(const vector<T> &a){
+    vector<string> bits;
+    for (const T &x: a)
+        bits.emplace_back((const char *)&x, sizeof(T));
+    sort(bits.begin(), bits.end());
+    return bits;
+}
+
+/**
+ * Floating ranges with +0, -0 and NaN through every path that reaches the
+ * network leaves: the output must hold exactly the input values, and be
+ * sorted where there is no NaN.
+ */
+template<typename T>
+void test_network_floats(const char *type, mt19937_64 &rng){
+    const T nan=numeric_limits<T>::quiet_NaN(), inf=numeric_limits<T>::infinity();
+    vector<vector<T>> inputs={{3, nan, 1, 2, 5, 4}, {-nan, inf, nan, -inf, 0, -0.0}};
+    uniform_int_distribution<int> pick(0, 9);
+    for (long int n: {2, 7, 16, 33, 64, 100, 1000, 5000}){
+        for (bool withNan: {false, true}){
+            vector<T> a(n);
+            for (T &x: a){
+                int r=pick(rng);
+                x=r<4 ? (T)0.0 : r<8 ? (T)-0.0 : r==8 && withNan ? nan : (T)(pick(rng)-5);
+            }
+            inputs.push_back(a);
+        }
+    }
+    for (const vector<T> &input: inputs){
+        bool hasNan=any_of(input.begin(), input.end(), [](T x){ return x!=x; });
+        string what=string(type)+" n="+to_string(input.size())+(hasNan ? " with NaN" : "");
+        vector<T> a=input;
+        quick_sort_inplace(a);
+        check(bit_patterns(a)==bit_patterns(input), "quick_sort_inplace keeps the values, "+what);
+        check(hasNan || is_sorted(a.begin(), a.end()), "quick_sort_inplace sorts, "+what);
+        a=input;
+        quick_sort_extra(a);
+        check(bit_patterns(a)==bit_patterns(input), "quick_sort_extra keeps the values, "+what);
+        check(hasNan || is_sorted(a.begin(), a.end()), "quick_sort_extra sorts, "+what);
+        a=input;
+        ::nth_element(a, (long int)a.size()/2);
+        check(bit_patterns(a)==bit_patterns(input), "nth_element keeps the values, "+what);
+        if constexpr (has_simd_network<T, less<T>>::value){
+            if ((long int)input.size()>network_capacity<T>())
+                continue;
+            a=input;
+            network_sort(a.data(), (long int)a.size(), less<T>());
+            check(bit_patterns(a)==bit_patterns(input), "network_sort keeps the values, "+what);
+            a.erase(remove_if(a.begin(), a.end(), [](T x){ return x!=x; }), a.end());
+            check(is_sorted(a.begin(), a.end()), "network_sort sorts the numbers among NaN, "+what);
+            a=input;
+            network_sort(a.data(), (long int)a.size(), greater<T>());
+            check(bit_patterns(a)==bit_patterns(input), "network_sort descending keeps the values, "+what);
+        }
+    }
+}
+
+/**
+ * radix_sort without a key, and auto_sort past its radix threshold in both
+ * directions, sort the bit patterns of the values and turn them back: the
+ * output must be sorted and hold exactly the input values.
+ */
+template<typename T>
+void test_radix_values(const char *type, mt19937_64 &rng){
+    for (long int n: {2, 1000, 100000}){
+        vector<T> input(n);
+        for (T &x: input){
+            x=(T)(int64_t)rng();
+            if constexpr (is_floating_point<T>::value)
+                if (rng()%8==0)
+                    x=rng()%2 ? (T)-0.0 : (T)0.0;
+        }
+        input[0]=numeric_limits<T>::lowest();
+        input[n-1]=numeric_limits<T>::max();
+        string what=string(type)+" n="+to_string(n);
+        vector<T> a=input;
+        radix_sort(a);
+        check(bit_patterns(a)==bit_patterns(input) && is_sorted(a.begin(), a.end()), "radix_sort sorts, "+what);
+        a=input;
+        auto_sort(a);
+        check(bit_patterns(a)==bit_patterns(input) && is_sorted(a.begin(), a.end()), "auto_sort sorts, "+what);
+        a=input;
+        auto_sort(a, greater<T>());
+        check(bit_patterns(a)==bit_patterns(input) && is_sorted(a.begin(), a.end(), greater<T>()),
+            "auto_sort descending sorts, "+what);
+    }
+}
+
+//Counted without a default constructor, which takes other paths through the sorts
+struct CountedOnly : Counted<long int> {
+    explicit CountedOnly(long int value) : Counted<long int>(value) {}
+};
+
+/**
+ * Every algorithm on n Counted elements: the output has to be sorted (or
+ * partitioned around n/2) and no element may have been copied. top_k is
+ * left out, it copies its k results out of a const input by design.
+ */
+template<typename T>
+void test_no_copies(const char *type, long int n, mt19937_64 &rng){
+    uniform_int_distribution<long int> pick(0, n/4);
+    vector<T> input;
+    for (long int i=0; i<n; i++)
+        input.emplace_back(pick(rng));
+    auto value=[](const T &x){ return x.value; };
+    auto sorted=[](const vector<T> &a){
+        return is_sorted(a.begin(), a.end(), [](const T &x, const T &y){ return x.value<y.value; });
+    };
+    ThreadPool pool(3);
+    vector<pair<string, function<void(vector<T> &)>>> algorithms={
+        {"merge_sort", [](vector<T> &a){ merge_sort(a); }},
+        {"quick_sort_extra", [](vector<T> &a){ quick_sort_extra(a); }},
+        {"quick_sort_inplace", [](vector<T> &a){ quick_sort_inplace(a); }},
+        {"auto_sort", [](vector<T> &a){ auto_sort(a); }},
+        {"radix_sort", [&](vector<T> &a){ radix_sort(a, value); }},
+        {"radix_sort_msd", [&](vector<T> &a){ radix_sort_msd(a, value); }},
+        {"sort_by_key", [&](vector<T> &a){ sort_by_key(a, value); }},
+        {"partial_sort", [](vector<T> &a){ ::partial_sort(a, (long int)a.size()); }},
+        {"parallel_merge_sort", [&](vector<T> &a){ parallel_merge_sort(a, less<T>(), pool); }},
+    };
+    if (n<=QUADRATIC_MAX){
+        algorithms.push_back({"bubble_sort", [](vector<T> &a){ bubble_sort(a); }});
+        algorithms.push_back({"insertion_sort", [](vector<T> &a){ insertion_sort(a); }});
+        algorithms.push_back({"selection_sort", [](vector<T> &a){ selection_sort(a); }});
+    }
+    if constexpr (is_default_constructible<T>::value){
+        algorithms.push_back({"block_merge_sort", [](vector<T> &a){ block_merge_sort(a); }});
+        algorithms.push_back({"parallel_sort", [&](vector<T> &a){ parallel_sort(a, less<T>(), pool); }});
+    }
+    SortStats stats;
+    Counted<long int>::stats=&stats;
+    for (auto &algorithm: algorithms){
+        vector<T> a;
+        for (const T &x: input)
+            a.emplace_back(x.value);
+        stats.reset();
+        algorithm.second(a);
+        string what=algorithm.first+" on "+to_string(n)+" "+type;
+        check(stats.copies==0, what+" copies no element, made "+to_string(stats.copies));
+        check(sorted(a), what+" sorts");
+    }
+    vector<T> a;
+    for (const T &x: input)
+        a.emplace_back(x.value);
+    stats.reset();
+    ::nth_element(a, n/2);
+    string what="nth_element on "+to_string(n)+" "+type;
+    check(stats.copies==0, what+" copies no element, made "+to_string(stats.copies));
+    check(all_of(a.begin(), a.begin()+n/2, [&](const T &x){ return x.value<=a[n/2].value; })
+        && all_of(a.begin()+n/2, a.end(), [&](const T &x){ return x.value>=a[n/2].value; }),
+        what+" puts the median in place");
+    Counted<long int>::stats=nullptr;
+}
+
+//move-only elements have to compile and sort with the algorithms that take a comparator
+void test_move_only(){
+    const long int n=1000;
+    vector<unique_ptr<long int>> input;
+    for (long int i=0; i<n; i++)
+        input.emplace_back(new long int((i*7919)%n));
+    auto less_ptr=[](const unique_ptr<long int> &x, const unique_ptr<long int> &y){ return *x<*y; };
+    auto run=[&](const string &name, auto sort_fn){
+        vector<unique_ptr<long int>> a;
+        for (const auto &x: input)
+            a.emplace_back(new long int(*x));
+        sort_fn(a);
+        bool ok=true;
+        for (long int i=0; i<n; i++)
+            ok&=a[i] && *a[i]==i;
+        check(ok, name+" sorts unique_ptr");
+    };
+    run("merge_sort", [&](auto &a){ merge_sort(a, less_ptr); });
+    run("quick_sort_extra", [&](auto &a){ quick_sort_extra(a, less_ptr); });
+    run("quick_sort_inplace", [&](auto &a){ quick_sort_inplace(a, less_ptr); });
+    run("auto_sort", [&](auto &a){ auto_sort(a, less_ptr); });
+    run("radix_sort", [](auto &a){ radix_sort(a, [](const unique_ptr<long int> &x){ return *x; }); });
+    run("sort_by_key", [](auto &a){ sort_by_key(a, [](const unique_ptr<long int> &x){ return *x; }); });
+}
+
+/**
+ * The stable key sorts on floating keys of +0 and -0, which compare equal:
+ * records with equal keys have to stay in their input order.
+ */
+template<typename K>
+void test_signed_zero_keys(const char *type){
+    struct Record {
+        K key;
+        long int at;
+    };
+    for (long int n: {100, 5000, 50000}){
+        vector<Record> input;
+        for (long int i=0; i<n; i++)
+            input.push_back({i%2 ? (K)-0.0 : (K)0.0, i});
+        //a few other keys, so that the zeros are not the whole range
+        for (long int i=0; i<n; i+=97)
+            input[i].key=(K)(i%3)-1;
+        auto key=[](const Record &r){ return r.key; };
+        auto stable=[](const vector<Record> &a, bool ascending){
+            for (size_t i=1; i<a.size(); i++){
+                if (ascending ? a[i].key<a[i-1].key : a[i-1].key<a[i].key)
+                    return false;
+                if (a[i].key==a[i-1].key && a[i].at<a[i-1].at)
+                    return false;
+            }
+            return true;
+        };
+        string what=string(type)+" keys, n="+to_string(n);
+        vector<Record> a=input;
+        sort_by_key(a, key);
+        check(stable(a, true), "sort_by_key keeps +0 and -0 in order, "+what);
+        a=input;
+        sort_by_key(a, key, greater<K>());
+        check(stable(a, false), "sort_by_key descending keeps +0 and -0 in order, "+what);
+        a=input;
+        radix_sort(a, key);
+        check(stable(a, true), "radix_sort keeps +0 and -0 in order, "+what);
+    }
+}
+
+/**
+ * parallel_sort through each of its overloads, on inputs past
+ * PARALLEL_SORT_CUTOFF with many and with few distinct keys; the output
+ * has to match std::sort.
+ */
+void test_parallel_sort(mt19937_64 &rng){
+    for (long int distinct: {1000000000L, 10L}){
+        vector<int> input(5*PARALLEL_SORT_CUTOFF);
+        for (int &x: input)
+            x=(int)(rng()%distinct);
+        vector<int> expect=input;
+        sort(expect.begin(), expect.end());
+        string what=" on "+to_string(input.size())+" ints, "+to_string(distinct)+" distinct";
+        vector<int> a=input;
+        parallel_sort(a);
+        check(a==expect, "parallel_sort with the default comparator"+what);
+        for (unsigned int threads: {1u, 2u, 5u}){
+            a=input;
+            parallel_sort(a, less<int>(), threads);
+            check(a==expect, "parallel_sort on "+to_string(threads)+" threads"+what);
+        }
+        ThreadPool pool(3);
+        a=input;
+        parallel_sort(a, less<int>(), pool);
+        check(a==expect, "parallel_sort on a pool"+what);
+        a=input;
+        parallel_sort(a, greater<int>(), 4);
+        check(equal(a.begin(), a.end(), expect.rbegin()), "parallel_sort descending"+what);
+    }
+}
+
+/**
+ * parallel_merge_sort well past PARALLEL_MERGE_CUTOFF, so that the
+ * co-ranked parallel merges run: records with equal keys have to keep
+ * their input order.
+ */
+void test_parallel_merge_sort(mt19937_64 &rng){
+    struct Record {
+        int key;
+        long int at;
+        bool operator<(const Record &other) const { return key<other.key; }
+    };
+    auto stable=[](const vector<Record> &a){
+        for (size_t i=1; i<a.size(); i++)
+            if (a[i].key<a[i-1].key || (a[i].key==a[i-1].key && a[i].at<a[i-1].at))
+                return false;
+        return true;
+    };
+    for (long int distinct: {1000000000L, 1000L, 3L}){
+        vector<Record> input(20*PARALLEL_MERGE_CUTOFF);
+        for (size_t i=0; i<input.size(); i++)
+            input[i]={(int)(rng()%distinct), (long int)i};
+        string what=" on "+to_string(input.size())+" records, "+to_string(distinct)+" distinct keys";
+        vector<Record> a=input;
+        parallel_merge_sort(a);
+        check(stable(a), "parallel_merge_sort with the default comparator is stable"+what);
+        for (unsigned int threads: {2u, 5u}){
+            a=input;
+            parallel_merge_sort(a, less<Record>(), threads);
+            check(stable(a), "parallel_merge_sort on "+to_string(threads)+" threads is stable"+what);
+        }
+        ThreadPool pool(3);
+        a=input;
+        parallel_merge_sort(a, less<Record>(), pool);
+        check(stable(a), "parallel_merge_sort on a pool is stable"+what);
+    }
+}
+
+/**
+ * block_merge_sort on records far larger than its cache, with one, a few
+ * and many distinct keys, so that the rotation, the buffered and the
+ * cached block merges all run: records with equal keys have to keep
+ * their input order. Ints go through the network run phase instead.
+ */
+void test_block_merge_sort(mt19937_64 &rng){
+    struct Record {
+        int key;
+        long int at;
+        bool operator<(const Record &other) const { return key<other.key; }
+    };
+    for (long int n: {1000L, 100000L, 300000L}){
+        for (long int distinct: {1L, 3L, 16L, 1000L, 1000000000L}){
+            vector<Record> a(n);
+            for (long int i=0; i<n; i++)
+                a[i]={(int)(rng()%distinct), i};
+            block_merge_sort(a);
+            bool stable=true;
+            for (long int i=1; i<n; i++)
+                if (a[i].key<a[i-1].key || (a[i].key==a[i-1].key && a[i].at<a[i-1].at))
+                    stable=false;
+            string what=" on "+to_string(n)+" records, "+to_string(distinct)+" distinct keys";
+            check(stable, "block_merge_sort is stable"+what);
+
+            vector<int> b(n);
+            for (int &x: b)
+                x=(int)(rng()%distinct);
+            vector<int> expect=b;
+            sort(expect.begin(), expect.end());
+            block_merge_sort(b);
+            check(b==expect, "block_merge_sort on "+to_string(n)+" ints, "+to_string(distinct)+" distinct");
+        }
+    }
+}
+
+/**
+ * external_sort on files in /tmp: one that fits in the memory budget, one
+ * that needs enough runs for several merge passes, and one whose size is
+ * not a whole number of records. The output has to be the input, sorted.
+ */
+void test_external_sort(mt19937_64 &rng){
+    string input="/tmp/sort_test."+to_string(getpid());
+    string output=input+".out";
+    auto write=[](const string &path, const vector<int> &a, long int extra){
+        FILE *f=fopen(path.c_str(), "wb");
+        fwrite(a.data(), sizeof(int), a.size(), f);
+        for (long int i=0; i<extra; i++)
+            fputc(0, f);
+        fclose(f);
+    };
+    auto read=[](const string &path){
+        vector<int> a;
+        FILE *f=fopen(path.c_str(), "rb");
+        if (f==nullptr)
+            return a;
+        int x;
+        while (fread(&x, sizeof(int), 1, f)==1)
+            a.push_back(x);
+        fclose(f);
+        return a;
+    };
+    //4 KiB gives runs of 341 ints and a fan-in of 2, so 20000 ints merge in 6 passes
+    for (long int n: {0L, 1000L, 20000L}){
+        for (long int memory: {4096L, 1L<<20}){
+            vector<int> a(n);
+            for (int &x: a)
+                x=(int)rng();
+            write(input, a, 0);
+            string what=" on "+to_string(n)+" ints with "+to_string(memory)+" bytes";
+            external_sort<int>(input, output, memory);
+            vector<int> expect=a;
+            sort(expect.begin(), expect.end());
+            check(read(output)==expect, "external_sort"+what);
+            external_sort<int>(input, output, memory, greater<int>());
+            check(read(output)==vector<int>(expect.rbegin(), expect.rend()), "external_sort descending"+what);
+        }
+    }
+    write(input, vector<int>(10), 3);
+    bool threw=false;
+    try {
+        external_sort<int>(input, output, 4096);
+    }
+    catch (const runtime_error &){
+        threw=true;
+    }
+    check(threw, "external_sort rejects a file that is not a whole number of records");
+    unlink(input.c_str());
+    unlink(output.c_str());
+}
+
+int main(){
+    mt19937_64 rng(281);
+    for (long int n: {10, 100, 10000}){
+        test_no_copies<Counted<long int>>("Counted", n, rng);
+        test_no_copies<CountedOnly>("CountedOnly", n, rng);
+    }
+    test_no_copies<Counted<long int>>("Counted", 200000, rng);
+    test_move_only();
+    test_radix_values<int>("int", rng);
+    test_radix_values<long int>("long", rng);
+    test_radix_values<unsigned int>("unsigned", rng);
+    test_radix_values<float>("float", rng);
+    test_radix_values<double>("double", rng);
+    test_signed_zero_keys<float>("float");
+    test_signed_zero_keys<double>("double");
+    test_parallel_sort(rng);
+    test_parallel_merge_sort(rng);
+    test_block_merge_sort(rng);
+    test_external_sort(rng);
+    test_network_floats<float>("float", rng);
+    test_network_floats<double>("double", rng);
+    if (failures==0)
+        printf("all tests passed\n");
+    return failures>0 ? 1 : 0;
+}
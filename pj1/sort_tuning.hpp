@@ -0,0 +1,11 @@
+#ifndef VE281P1_SORT_TUNING_HPP
+#define VE281P1_SORT_TUNING_HPP
+
+//crossovers used by auto_sort, regenerate with: ./sort_calibrate > sort_tuning.hpp
+const long int AUTO_INSERTION_MAX=20;
+const long int AUTO_INSERTION_INVERSIONS=16;
+const long int AUTO_MERGE_RUNS_EXPONENT=33;
+const long int AUTO_RADIX_MIN_NARROW=2048;
+const long int AUTO_RADIX_MIN_WIDE=4096;
+
+#endif //VE281P1_SORT_TUNING_HPP
@@ -0,0 +1,181 @@
+#ifndef VE281P1_THREAD_POOL_HPP
+#define VE281P1_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A work-stealing thread pool.
+ * Every worker owns a deque: it pushes and pops its own tasks at the back
+ * (newest first, which keeps fork-join recursion cache friendly) and,
+ * when that is empty, steals from the front of the other deques (oldest
+ * first, which are the biggest pieces of work). Tasks submitted from
+ * outside the pool go to one extra shared deque.
+ * A pool can be shared by any number of sorts and other engines.
+ */
+class ThreadPool {
+public:
+    typedef std::function<void()> Task;
+
+    explicit ThreadPool(unsigned int threads = std::thread::hardware_concurrency())
+        : queues(), workers(), stop(false), pending(0) {
+        if (threads==0)
+            threads=1;
+        for (unsigned int i=0; i<=threads; i++)
+            queues.emplace_back(new Queue());
+        for (unsigned int i=0; i<threads; i++)
+            workers.emplace_back(&ThreadPool::work, this, i);
+    }
+
+    ThreadPool(const ThreadPool &)=delete;
+    ThreadPool &operator=(const ThreadPool &)=delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            stop=true;
+        }
+        wake.notify_all();
+        for (auto &w: workers)
+            w.join();
+    }
+
+    /**
+     * Number of worker threads
+     */
+    unsigned int size() const { return (unsigned int)workers.size(); }
+
+    /**
+     * Queue a task, on the calling worker's own deque if it is a worker
+     */
+    void submit(Task task) {
+        Queue &q=*queues[self()];
+        {
+            std::lock_guard<std::mutex> guard(q.lock);
+            q.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            pending++;
+        }
+        wake.notify_one();
+    }
+
+    /**
+     * Run one queued task on the calling thread, if there is any.
+     * Used by waiters so that blocking on a subtask never idles a worker.
+     * @return whether a task was run
+     */
+    bool run_one() {
+        Task task;
+        if (!take(self(), task))
+            return false;
+        task();
+        return true;
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    bool stop;
+    std::atomic<long int> pending;
+
+    static inline thread_local const ThreadPool *owner=nullptr;
+    static inline thread_local unsigned int index=0;
+
+    //deque of the calling thread; outsiders share the last one
+    unsigned int self() const {
+        return owner==this ? index : (unsigned int)workers.size();
+    }
+
+    bool take(unsigned int me, Task &task) {
+        if (pending.load()==0)
+            return false;
+        {
+            Queue &q=*queues[me];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (!q.tasks.empty()){
+                task=std::move(q.tasks.back());
+                q.tasks.pop_back();
+                pending--;
+                return true;
+            }
+        }
+        for (unsigned int k=1; k<queues.size(); k++){
+            Queue &q=*queues[(me+k)%queues.size()];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (!q.tasks.empty()){
+                task=std::move(q.tasks.front());
+                q.tasks.pop_front();
+                pending--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(unsigned int i) {
+        owner=this;
+        index=i;
+        while (1){
+            Task task;
+            if (take(i, task)){
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleepLock);
+            wake.wait(guard, [this]{ return stop || pending.load()>0; });
+            if (stop)
+                return ;
+        }
+    }
+};
+
+/**
+ * Fork-join helper: run() forks a task onto the pool, wait() blocks until
+ * all of them finished, executing queued tasks in the meantime.
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool &pool) : pool(pool), running(0) {}
+
+    TaskGroup(const TaskGroup &)=delete;
+    TaskGroup &operator=(const TaskGroup &)=delete;
+
+    ~TaskGroup() { wait(); }
+
+    template<typename Fn>
+    void run(Fn fn) {
+        running++;
+        pool.submit([this, fn]() {
+            fn();
+            running--;
+        });
+    }
+
+    void wait() {
+        while (running.load()>0){
+            if (!pool.run_one())
+                std::this_thread::yield();
+        }
+    }
+
+private:
+    ThreadPool &pool;
+    std::atomic<long int> running;
+};
+
+#endif //VE281P1_THREAD_POOL_HPP
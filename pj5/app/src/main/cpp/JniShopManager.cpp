@@ -30,24 +30,33 @@ JniShop *ShopManager::findByName(string name) {
     return find->second;
 }
 
-struct _LIBCPP_TEMPLATE_VIS lessPrice : binary_function<JniShop *, JniShop *, bool> {
-    _LIBCPP_CONSTEXPR_AFTER_CXX11 _LIBCPP_INLINE_VISIBILITY bool operator()(const JniShop *__x, const JniShop *__y) const {
-        return __x->avgCost < __y->avgCost;
+struct lessPrice {
+    bool operator()(const JniShop *x, const JniShop *y) const {
+        return x->avgCost < y->avgCost;
     }
 };
 
 void ShopManager::orderByPrice() {
-    quick_sort_inplace(*innerVector, lessPrice());
+    // cache the prices so the sort never chases the shop pointers
+    sort_by_key(*innerVector, [](const JniShop *shop) { return shop->avgCost; });
 }
 
-struct _LIBCPP_TEMPLATE_VIS GreaterRating : binary_function<JniShop *, JniShop *, bool> {
-    _LIBCPP_CONSTEXPR_AFTER_CXX11 _LIBCPP_INLINE_VISIBILITY bool operator()(const JniShop *__x, const JniShop *__y) const {
-        return __x->rating > __y->rating;
+void ShopManager::orderTopByPrice(jint k) {
+    partial_sort(*innerVector, k, lessPrice());
+}
+
+struct GreaterRating {
+    bool operator()(const JniShop *x, const JniShop *y) const {
+        return x->rating > y->rating;
     }
 };
 
 void ShopManager::orderByRating() {
-    quick_sort_inplace(*innerVector, GreaterRating());
+    sort_by_key(*innerVector, [](const JniShop *shop) { return shop->rating; }, greater<jint>());
+}
+
+void ShopManager::orderTopByRating(jint k) {
+    partial_sort(*innerVector, k, GreaterRating());
 }
 
 long ShopManager::findByLocation(jint x, jint y, jint distance) {
@@ -172,6 +181,16 @@ Java_com_example_myapplication_ShopManager_orderByPrice(JNIEnv *env, jobject thi
     ShopManager *shopManager = GetShopManager(env, thiz);
     shopManager->orderByPrice();
 }
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_myapplication_ShopManager_orderTopByRating(JNIEnv *env, jobject thiz, jint k) {
+    ShopManager *shopManager = GetShopManager(env, thiz);
+    shopManager->orderTopByRating(k);
+}
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_myapplication_ShopManager_orderTopByPrice(JNIEnv *env, jobject thiz, jint k) {
+    ShopManager *shopManager = GetShopManager(env, thiz);
+    shopManager->orderTopByPrice(k);
+}
 
 extern "C" JNIEXPORT jlong
 JNICALL
@@ -51,6 +51,18 @@ public:
      */
     void orderByRating();
 
+    /**
+     * move the k cheapest shops to the front, ordered by price,
+     * the remaining shops are left in unspecified order
+     */
+    void orderTopByPrice(jint k);
+
+    /**
+     * move the k best rated shops to the front, ordered by rating,
+     * the remaining shops are left in unspecified order
+     */
+    void orderTopByRating(jint k);
+
     /**
      * find shop nearby the given location
      *
@@ -124,6 +136,12 @@ Java_com_example_myapplication_ShopManager_orderByRating(JNIEnv *env, jobject th
 extern "C" JNIEXPORT void JNICALL
 Java_com_example_myapplication_ShopManager_orderByPrice(JNIEnv *env, jobject thiz);
 
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_myapplication_ShopManager_orderTopByRating(JNIEnv *env, jobject thiz, jint k);
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_myapplication_ShopManager_orderTopByPrice(JNIEnv *env, jobject thiz, jint k);
+
 extern "C" JNIEXPORT jlong
 JNICALL
 Java_com_example_myapplication_ShopManager_findByName(JNIEnv *env, jobject thiz, jstring name);
@@ -3,23 +3,42 @@
 
 #include <vector>
 #include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
 #include <functional>
+#include <utility>
+#include <type_traits>
+#include <iterator>
+#include <algorithm>
+#include <memory>
+
+#include "sort_network.hpp"
+#include "sort_instrument.hpp"
+#include "sort_tuning.hpp"
+
+//whether RandomIt walks contiguous storage, so leaves can be handed to network_sort
+template<typename RandomIt>
+struct is_contiguous_iterator : std::integral_constant<bool, std::is_pointer<RandomIt>::value
+    || std::is_same<RandomIt, typename std::vector<typename std::iterator_traits<RandomIt>::value_type>::iterator>::value> {};
+
 
 template<typename T>
 void swap(std::vector<T> &vector, long unsigned int i, long unsigned int j){
-    auto temp= vector[i];
-    vector[i]=vector[j];
-    vector[j]=temp;
+    auto temp=std::move(vector[i]);
+    vector[i]=std::move(vector[j]);
+    vector[j]=std::move(temp);
 }
 
-template<typename T, typename Compare>
-void bubble_sort(std::vector<T> &vector, Compare comp = std::less<T>()) {
-    for(long unsigned int ix=vector.size()-1; ix>0; ix--){
+template<typename RandomIt, typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+void bubble_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    long int n=last-first;
+    for(long int ix=n-1; ix>0; ix--){
         int swapCnt=0;
-        for (long unsigned int jx=0; jx<ix; jx++)
-            // if (vector[jx]!=vector[jx+1] && !comp(vector[jx],vector[jx+1])){
-            if (comp(vector[jx+1],vector[jx])){
-                swap(vector,jx,jx+1);
+        for (long int jx=0; jx<ix; jx++)
+            // if (first[jx]!=first[jx+1] && !comp(first[jx],first[jx+1])){
+            if (comp(first[jx+1],first[jx])){
+                std::iter_swap(first+jx, first+jx+1);
                 swapCnt++;
             }
         if (!swapCnt)
@@ -27,126 +46,1539 @@ void bubble_sort(std::vector<T> &vector, Compare comp = std::less<T>()) {
     }
 }
 
-template<typename T, typename Compare>
-void insertion_sort(std::vector<T> &vector, Compare comp = std::less<T>()) {
-    for (long unsigned int i=1; i<vector.size(); i++){
-        if (comp(vector[i],vector[i-1])){
-            auto temp=vector[i];
-            for (long unsigned int j=i-1; ; j--){
-                if (j<i && comp(temp,vector[j]) )
-                    vector[j+1]=vector[j];
-                else if(j>=i){
-                    vector[0]=temp;
-                    break;
-                }
-                else {
-                    vector[j+1]=temp;
-                    break;
-                }
-            }
+template<typename T, typename Compare = std::less<T>>
+void bubble_sort(std::vector<T> &vector, Compare comp = Compare()) {
+    bubble_sort(vector.begin(), vector.end(), comp);
+}
+
+template<typename RandomIt, typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+void insertion_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    long int n=last-first;
+    for (long int i=1; i<n; i++){
+        if (comp(first[i],first[i-1])){
+            auto temp=std::move(first[i]);
+            long int j=i;
+            do {
+                first[j]=std::move(first[j-1]);
+                j--;
+            } while (j>0 && comp(temp,first[j-1]));
+            first[j]=std::move(temp);
         }
     }
 }
 
-template<typename T, typename Compare>
-void selection_sort(std::vector<T> &vector, Compare comp = std::less<T>()) {
-    for (long unsigned int i=0; i<vector.size()-1; i++){
-        long unsigned int index=i;
-        for (long unsigned int j=i; j<vector.size()-1; j++){
-            // if(vector[index]!=vector[j+1] && !comp(vector[index],vector[j+1]))
-            if(comp(vector[j+1],vector[index]))
+template<typename T, typename Compare = std::less<T>>
+void insertion_sort(std::vector<T> &vector, Compare comp = Compare()) {
+    insertion_sort(vector.begin(), vector.end(), comp);
+}
+
+template<typename RandomIt, typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+void selection_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    long int n=last-first;
+    for (long int i=0; i<n-1; i++){
+        long int index=i;
+        for (long int j=i; j<n-1; j++){
+            // if(first[index]!=first[j+1] && !comp(first[index],first[j+1]))
+            if(comp(first[j+1],first[index]))
                 index=j+1;
         }
-        swap(vector, i, index);
+        std::iter_swap(first+i, first+index);
     }
 }
 
+template<typename T, typename Compare = std::less<T>>
+void selection_sort(std::vector<T> &vector, Compare comp = Compare()) {
+    selection_sort(vector.begin(), vector.end(), comp);
+}
+
+//elements of a and b are moved into C
 template<typename T, typename Compare>
 void merge(std::vector<T> &a, std::vector<T> &b, std::vector<T> &C, Compare comp = std::less<T>()) {
     auto ita=a.begin(), itb=b.begin();
     while (ita!=a.end() && itb!=b.end()){
         // if (comp(*ita,*itb) || *ita==*itb)
         if (!comp(*itb,*ita))
-            C.push_back(*ita++);
+            C.push_back(std::move(*ita++));
         else
-            C.push_back(*itb++);
+            C.push_back(std::move(*itb++));
     }
     if (ita==a.end())
-        C.insert(C.end(), itb, b.end());
+        C.insert(C.end(), std::make_move_iterator(itb), std::make_move_iterator(b.end()));
     else
-        C.insert(C.end(), ita, a.end());
+        C.insert(C.end(), std::make_move_iterator(ita), std::make_move_iterator(a.end()));
 }
 
+/**
+ * Tournament (loser) tree over k sorted sources whose current heads are
+ * given as pointers, nullptr meaning exhausted. Every internal node
+ * remembers the loser of the match played there, so replacing the
+ * winner's head costs exactly one comparison per level. Ties go to the
+ * lower source index, which keeps merges stable.
+ * The sources themselves stay with the caller, so they can be anything
+ * from iterator ranges to blocks streamed in from disk.
+ */
 template<typename T, typename Compare>
-void merge_sort(std::vector<T> &vector, Compare comp = std::less<T>()) {
-    auto mid=vector.begin()+vector.size()/2;
-    if (mid==vector.begin())
+class LoserTree {
+public:
+    LoserTree(long int k, Compare comp) : head(k, nullptr), loser(k, 0), winner(0), comp(comp) {}
+
+    //set the head of source i before build()
+    void set(long int i, const T *value) { head[i]=value; }
+
+    void build() {
+        long int k=(long int)head.size();
+        std::vector<long int> win(2*k);
+        for (long int i=0; i<k; i++)
+            win[k+i]=i;
+        for (long int node=k-1; node>=1; node--){
+            long int a=win[2*node], b=win[2*node+1];
+            if (!beats(a, b))
+                std::swap(a, b);
+            win[node]=a;
+            loser[node]=b;
+        }
+        winner=k>1 ? win[1] : 0;
+    }
+
+    //source of the smallest head, -1 once every source is exhausted
+    long int top() const { return head[winner] ? winner : -1; }
+
+    const T &value() const { return *head[winner]; }
+
+    //give the winner its next head and replay its path to the root
+    void replace(const T *value) {
+        long int k=(long int)head.size(), w=winner;
+        head[w]=value;
+        for (long int node=(k+w)/2; node>=1; node/=2){
+            if (beats(loser[node], w))
+                std::swap(loser[node], w);
+        }
+        winner=w;
+    }
+
+private:
+    std::vector<const T *> head;
+    std::vector<long int> loser;
+    long int winner;
+    Compare comp;
+
+    bool beats(long int a, long int b) const {
+        if (!head[a] || !head[b])
+            return head[a] ? true : (head[b] ? false : a<b);
+        if (comp(*head[a], *head[b]))
+            return true;
+        return !comp(*head[b], *head[a]) && a<b;
+    }
+};
+
+/**
+ * k-way merge of the sorted ranges runs[i]=(first, last) into out, which
+ * must have room for all of them; the runs are left untouched and their
+ * elements are copied. Equal elements come out in run order, so merging
+ * the shards of a stable sort stays stable.
+ * Every element is read once, unlike pairwise merging which re-reads
+ * the data log k times.
+ * Time complexity: O(n log k)
+ * @return the end of the written output
+ */
+template<typename ForwardIt, typename OutputIt,
+    typename Compare = std::less<typename std::iterator_traits<ForwardIt>::value_type>>
+OutputIt kway_merge(const std::vector<std::pair<ForwardIt, ForwardIt>> &runs, OutputIt out,
+    Compare comp = Compare()) {
+    typedef typename std::iterator_traits<ForwardIt>::value_type T;
+    long int k=(long int)runs.size();
+    if (k==0)
+        return out;
+    std::vector<ForwardIt> at(k);
+    LoserTree<T, Compare> tree(k, comp);
+    for (long int i=0; i<k; i++){
+        at[i]=runs[i].first;
+        tree.set(i, at[i]!=runs[i].second ? std::addressof(*at[i]) : nullptr);
+    }
+    tree.build();
+    for (long int r=tree.top(); r>=0; r=tree.top()){
+        *out=tree.value();
+        ++out;
+        ++at[r];
+        tree.replace(at[r]!=runs[r].second ? std::addressof(*at[r]) : nullptr);
+    }
+    return out;
+}
+
+template<typename T, typename OutputIt, typename Compare = std::less<T>>
+OutputIt kway_merge(const std::vector<std::vector<T>> &runs, OutputIt out, Compare comp = Compare()) {
+    typedef typename std::vector<T>::const_iterator It;
+    std::vector<std::pair<It, It>> ranges;
+    ranges.reserve(runs.size());
+    for (auto &run: runs)
+        ranges.emplace_back(run.begin(), run.end());
+    return kway_merge(ranges, out, comp);
+}
+
+//runs shorter than this are extended by binary insertion before merging
+const long int MIN_RUN=32;
+//consecutive wins of one side after which merge_runs starts galloping
+const long int MIN_GALLOP=7;
+
+/**
+ * Find the natural run starting at left and return its end (exclusive).
+ * A strictly descending run is reversed in place, which keeps it stable.
+ */
+template<typename RandomIt, typename Compare>
+long int find_run(RandomIt first, long int left, long int n, Compare comp){
+    long int i=left+1;
+    if (i==n)
+        return n;
+    if (comp(first[i],first[i-1])){
+        while (i+1<n && comp(first[i+1],first[i]))
+            i++;
+        for (long int l=left, r=i; l<r; l++, r--)
+            std::iter_swap(first+l, first+r);
+    }
+    else{
+        while (i+1<n && !comp(first[i+1],first[i]))
+            i++;
+    }
+    return i+1;
+}
+
+//extend the sorted prefix [left, sorted) to [left, end) by stable binary insertion
+template<typename RandomIt, typename Compare>
+void binary_insertion_helper(RandomIt first, long int left, long int sorted, long int end, Compare comp){
+    for (long int i=sorted; i<end; i++){
+        long int lo=left, hi=i;
+        while (lo<hi){
+            long int mid=lo+(hi-lo)/2;
+            if (comp(first[i],first[mid]))
+                hi=mid;
+            else
+                lo=mid+1;
+        }
+        if (lo==i)
+            continue;
+        auto temp=std::move(first[i]);
+        for (long int j=i; j>lo; j--)
+            first[j]=std::move(first[j-1]);
+        first[lo]=std::move(temp);
+    }
+}
+
+/**
+ * Exponential then binary search in [lo, hi) for the first element that
+ * should come after key: with upper set, elements equal to key stay in
+ * front of it, otherwise they go behind it.
+ * Time complexity: O(log d), d is the distance to the answer
+ */
+template<typename RandomIt, typename T, typename Compare>
+long int gallop(RandomIt first, long int lo, long int hi, const T &key, bool upper, Compare comp){
+    auto before=[&](const T &x){ return upper ? !comp(key,x) : comp(x,key); };
+    long int cur=lo, step=1;
+    while (cur<hi && before(first[cur])){
+        lo=cur+1;
+        cur+=step;
+        step*=2;
+    }
+    if (cur>hi)
+        cur=hi;
+    while (lo<cur){
+        long int mid=lo+(cur-lo)/2;
+        if (before(first[mid]))
+            lo=mid+1;
+        else
+            cur=mid;
+    }
+    return lo;
+}
+
+/**
+ * Stable merge of the adjacent runs src[lo, mid) and src[mid, hi) into
+ * dst[lo, hi). Once one side wins MIN_GALLOP times in a row, the length
+ * of its winning streak is found by galloping and copied as a block.
+ */
+template<typename SrcIt, typename DstIt, typename Compare>
+void merge_runs(SrcIt src, DstIt dst, long int lo, long int mid, long int hi, Compare comp){
+    long int i=lo, j=mid, k=lo;
+    long int winA=0, winB=0;
+    if (comp(src[mid],src[mid-1])){
+        while (i<mid && j<hi){
+            if (comp(src[j],src[i])){
+                dst[k++]=std::move(src[j++]);
+                winB++;
+                winA=0;
+            }
+            else{
+                dst[k++]=std::move(src[i++]);
+                winA++;
+                winB=0;
+            }
+            if (i==mid || j==hi)
+                break;
+            if (winA>=MIN_GALLOP){
+                for (long int e=gallop(src, i, mid, src[j], true, comp); i<e; )
+                    dst[k++]=std::move(src[i++]);
+                winA=0;
+            }
+            else if (winB>=MIN_GALLOP){
+                for (long int e=gallop(src, j, hi, src[i], false, comp); j<e; )
+                    dst[k++]=std::move(src[j++]);
+                winB=0;
+            }
+        }
+    }
+    while (i<mid)
+        dst[k++]=std::move(src[i++]);
+    while (j<hi)
+        dst[k++]=std::move(src[j++]);
+}
+
+/**
+ * Extend the sorted prefix [left, end) to [left, limit): by binary
+ * insertion, or for integers that fit a sorting network by sorting the
+ * whole range with it
+ */
+template<typename RandomIt, typename Compare>
+void extend_run(RandomIt first, long int left, long int end, long int limit, Compare comp){
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    //equal integers are indistinguishable, so the network cannot break stability
+    if constexpr (std::is_integral<T>::value && has_simd_network<T, Compare>::value
+        && is_contiguous_iterator<RandomIt>::value){
+        if (limit-left<=network_capacity<T>()){
+            network_sort(&*(first+left), limit-left, comp);
+            return ;
+        }
+    }
+    binary_insertion_helper(first, left, end, limit, comp);
+}
+
+/**
+ * Split [left, right) into natural runs, padding short ones to MIN_RUN,
+ * and return the run boundaries (first run start, ..., right).
+ */
+template<typename RandomIt, typename Compare>
+std::vector<long int> collect_runs(RandomIt first, long int left, long int right, Compare comp){
+    SortTimer<Compare> timer(comp, SORT_PHASE_RUNS);
+    std::vector<long int> runs;
+    while (left<right){
+        long int end=find_run(first, left, right, comp);
+        long int limit=left+MIN_RUN<right ? left+MIN_RUN : right;
+        if (end<limit){
+            extend_run(first, left, end, limit, comp);
+            end=limit;
+        }
+        runs.push_back(left);
+        left=end;
+    }
+    runs.push_back(right);
+    return runs;
+}
+
+//merge runs pairwise from src into dst, return the boundaries of the merged runs
+template<typename SrcIt, typename DstIt, typename Compare>
+std::vector<long int> merge_pass(SrcIt src, DstIt dst, const std::vector<long int> &runs, Compare comp){
+    std::vector<long int> next;
+    long int right=runs.back();
+    long unsigned int r=0;
+    for (; r+2<runs.size(); r+=2){
+        merge_runs(src, dst, runs[r], runs[r+1], runs[r+2], comp);
+        next.push_back(runs[r]);
+    }
+    if (r+1<runs.size()){
+        for (long int i=runs[r]; i<right; i++)
+            dst[i]=std::move(src[i]);
+        next.push_back(runs[r]);
+    }
+    next.push_back(right);
+    return next;
+}
+
+/**
+ * Merge adjacent runs pass by pass, ping-ponging between first and
+ * buffer over the span the runs cover.
+ * @return whether the sorted span ended up in buffer
+ */
+template<typename RandomIt, typename BufferIt, typename Compare>
+bool merge_passes(RandomIt first, BufferIt buffer, std::vector<long int> runs, Compare comp){
+    SortTimer<Compare> timer(comp, SORT_PHASE_MERGE);
+    bool in_buffer=false;
+    while (runs.size()>2){
+        if (in_buffer)
+            runs=merge_pass(buffer, first, runs, comp);
+        else
+            runs=merge_pass(first, buffer, runs, comp);
+        in_buffer=!in_buffer;
+    }
+    return in_buffer;
+}
+
+/**
+ * Natural bottom-up merge sort. Ascending and descending runs are taken
+ * as they are (short ones padded to MIN_RUN), then adjacent runs are
+ * merged pass by pass, ping-ponging between the range and one buffer.
+ * Time complexity: O(n log r), r is the number of runs; O(n) if sorted
+ */
+template<typename RandomIt, typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+void merge_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    long int n=last-first;
+    if (n<2)
+        return ;
+    std::vector<long int> runs=collect_runs(first, 0, n, comp);
+    if (runs.size()==2)
         return ;
-    //no need to assign, just specify the index
-    std::vector<T> left, right;
-    left.assign(vector.begin(),mid);
-    right.assign(mid,vector.end());
-    merge_sort(left, comp);
-    merge_sort(right, comp);
-    vector.clear();
-    merge(left, right, vector, comp);
+    //the data starts out in the buffer, so the passes end in whichever side
+    sort_allocation(comp, n*sizeof(T));
+    std::vector<T> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+    if (!merge_passes(buffer.begin(), first, runs, comp))
+        std::move(buffer.begin(), buffer.end(), first);
 }
 
-template<typename T, typename Compare>
-long int partition(std::vector<T> &vector, long int left, long int right, Compare comp = std::less<T>()){
-    long int pivotat=left+(right-left)/2;
-    std::vector<T> v2(vector);
-    long int l=left, r=right;
-    for (long int i=left; i<=right; i++){
-        if (comp(v2[i],v2[pivotat]))
-            vector[l++]=v2[i];
-        else if (comp(v2[pivotat],v2[i]))
-            vector[r--]=v2[i];
-        else{}
-    }
-    for (long int i=l; i<=r; i++)
-        vector[i]=v2[pivotat];
-    return l;
+template<typename T, typename Compare = std::less<T>>
+void merge_sort(std::vector<T> &vector, Compare comp = Compare()) {
+    merge_sort(vector.begin(), vector.end(), comp);
 }
 
-template<typename T, typename Compare>
-long int in_place_partition(std::vector<T> &vector, long int left, long int right, Compare comp = std::less<T>()){
-    // long unsigned int pivotat=left+(right-left)/2;
-    // swap(vector, pivotat, left);
-    long int l=left+1, r=right;
+template<typename RandomIt, typename Compare>
+long int in_place_partition(RandomIt first, long int left, long int right, Compare comp){
+    // pivot is first[left]; both scans stop on keys equal to the pivot,
+    // so a run of duplicates is split in half instead of peeled one by one
+    long int l=left, r=right+1;
     while(1){
-        while (comp(vector[l], vector[left]))
-            l++;
-        while (!comp(vector[r], vector[left])&& r!=left)
-            r--;
-        if (l<r)
-            swap(vector, l, r);
-        else
+        while (comp(first[++l], first[left]))
+            if (l==right)
+                break;
+        while (comp(first[left], first[--r]))
+            ;
+        if (l>=r)
             break;
+        std::iter_swap(first+l, first+r);
     }
-    swap(vector, left, r);
+    std::iter_swap(first+left, first+r);
     return r;
 }
 
-template<typename T, typename Compare>
-void qs_helper(std::vector<T> &vector, long int left, long int right,
-               long int (*par) (std::vector<T> &, long int, long int, Compare),
-               Compare comp = std::less<T>()){
-    long int pivotat;
-    if (left>=right)
+//ranges no longer than this are finished by insertion sort
+const long int INSERTION_SORT_CUTOFF=16;
+//ranges longer than this take the ninther instead of the median of three
+const long int NINTHER_CUTOFF=128;
+
+template<typename RandomIt, typename Compare>
+void insertion_sort_helper(RandomIt first, long int left, long int right, Compare comp){
+    for (long int i=left+1; i<=right; i++){
+        if (comp(first[i],first[i-1])){
+            auto temp=std::move(first[i]);
+            long int j=i;
+            do {
+                first[j]=std::move(first[j-1]);
+                j--;
+            } while (j>left && comp(temp,first[j-1]));
+            first[j]=std::move(temp);
+        }
+    }
+}
+
+//whether the network can take the leaves of a range behind RandomIt
+template<typename RandomIt, typename Compare>
+constexpr bool use_network(){
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    return has_simd_network<T, Compare>::value && is_contiguous_iterator<RandomIt>::value;
+}
+
+//ranges no longer than this are left to leaf_sort_helper
+template<typename RandomIt, typename Compare>
+constexpr long int leaf_cutoff(){
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    if constexpr (use_network<RandomIt, Compare>())
+        return network_capacity<T>();
+    else
+        return INSERTION_SORT_CUTOFF;
+}
+
+//vectorized network where sort_network.hpp has one for T and Compare, insertion sort otherwise
+template<typename RandomIt, typename Compare>
+void leaf_sort_helper(RandomIt first, long int left, long int right, Compare comp){
+    if constexpr (use_network<RandomIt, Compare>()){
+        if (right>left)
+            network_sort(&*(first+left), right-left+1, comp);
+    }
+    else
+        insertion_sort_helper(first, left, right, comp);
+}
+
+template<typename RandomIt, typename Compare>
+void sift_down(RandomIt first, long int left, long int root, long int size, Compare comp){
+    //heap indices are relative to left
+    while (1){
+        long int child=2*root+1;
+        if (child>=size)
+            break;
+        if (child+1<size && comp(first[left+child],first[left+child+1]))
+            child++;
+        if (!comp(first[left+root],first[left+child]))
+            break;
+        std::iter_swap(first+left+root, first+left+child);
+        root=child;
+    }
+}
+
+template<typename RandomIt, typename Compare>
+void heap_sort_helper(RandomIt first, long int left, long int right, Compare comp){
+    long int size=right-left+1;
+    for (long int i=size/2-1; i>=0; i--)
+        sift_down(first, left, i, size, comp);
+    for (long int end=size-1; end>0; end--){
+        std::iter_swap(first+left, first+left+end);
+        sift_down(first, left, 0, end, comp);
+    }
+}
+
+template<typename RandomIt, typename Compare>
+long int median_of_three(RandomIt first, long int a, long int b, long int c, Compare comp){
+    if (comp(first[a],first[b])){
+        if (comp(first[b],first[c]))
+            return b;
+        return comp(first[a],first[c]) ? c : a;
+    }
+    if (comp(first[a],first[c]))
+        return a;
+    return comp(first[b],first[c]) ? c : b;
+}
+
+template<typename RandomIt, typename Compare>
+long int choose_pivot(RandomIt first, long int left, long int right, Compare comp){
+    long int mid=left+(right-left)/2;
+    if (right-left+1<=NINTHER_CUTOFF)
+        return median_of_three(first, left, mid, right, comp);
+    long int step=(right-left+1)/8;
+    return median_of_three(first,
+        median_of_three(first, left, left+step, left+2*step, comp),
+        median_of_three(first, mid-step, mid, mid+step, comp),
+        median_of_three(first, right-2*step, right-step, right, comp), comp);
+}
+
+/**
+ * Introsort loop: quicksort that only recurses into the smaller side,
+ * switches to heapsort once depth runs out and leaves short ranges
+ * to insertion sort.
+ * Time complexity: O(n log n) worst case, O(log n) stack
+ */
+template<typename RandomIt, typename Compare>
+void introsort_helper(RandomIt first, long int left, long int right, int depth, Compare comp){
+    SortFrame<Compare> frame(comp);
+    while (right-left+1>leaf_cutoff<RandomIt, Compare>()){
+        if (depth==0){
+            SortTimer<Compare> timer(comp, SORT_PHASE_HEAP);
+            heap_sort_helper(first, left, right, comp);
+            return ;
+        }
+        depth--;
+        long int pivotat;
+        {
+            SortTimer<Compare> timer(comp, SORT_PHASE_PARTITION);
+            std::iter_swap(first+left, first+choose_pivot(first, left, right, comp));
+            pivotat=in_place_partition(first, left, right, comp);
+        }
+        if (pivotat-left<right-pivotat){
+            introsort_helper(first, left, pivotat-1, depth, comp);
+            left=pivotat+1;
+        }
+        else{
+            introsort_helper(first, pivotat+1, right, depth, comp);
+            right=pivotat-1;
+        }
+    }
+    SortTimer<Compare> timer(comp, SORT_PHASE_LEAF);
+    leaf_sort_helper(first, left, right, comp);
+}
+
+//2*floor(log2(n)), the partition budget before introsort gives up on quicksort
+inline int introsort_depth(long int n){
+    int depth=0;
+    while (n>1){
+        n>>=1;
+        depth+=2;
+    }
+    return depth;
+}
+
+//widest element partition stores three times to avoid a branch; wider ones cost more in stores than in mispredictions
+const long int BRANCHLESS_PARTITION_BYTES=16;
+
+/**
+ * Three-way partition of [left, right] around a median-of-three pivot.
+ * Keys less than the pivot are compacted in place, the rest are parked in
+ * scratch (equal ones from the front, greater ones from the back) and
+ * copied back behind them, so no allocation happens per call.
+ * On return [left, lo) < pivot, [lo, hi] == pivot, (hi, right] > pivot.
+ * Time complexity: O(right-left)
+ */
+template<typename RandomIt, typename ScratchIt, typename Compare>
+void partition(RandomIt first, ScratchIt scratch, long int left, long int right,
+    long int &lo, long int &hi, Compare comp){
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    std::iter_swap(first+left, first+choose_pivot(first, left, right, comp));
+    const T &pivot=first[left];
+    long int l=left+1, e=0, g=right-left-1;
+    for (long int i=left+1; i<=right; i++){
+        if constexpr (std::is_trivially_copyable<T>::value && sizeof(T)<=BRANCHLESS_PARTITION_BYTES){
+            //store unconditionally and only bump the matching cursor,
+            //so the loop body has no data-dependent branch
+            T x=first[i];
+            bool lt=comp(x,pivot), gt=comp(pivot,x);
+            first[l]=x;
+            scratch[e]=x;
+            scratch[g]=x;
+            l+=lt;
+            e+=!lt && !gt;
+            g-=gt;
+        }
+        else{
+            if (comp(first[i],pivot)){
+                if (l!=i)
+                    first[l]=std::move(first[i]);
+                l++;
+            }
+            else if (comp(pivot,first[i]))
+                scratch[g--]=std::move(first[i]);
+            else
+                scratch[e++]=std::move(first[i]);
+        }
+    }
+    std::iter_swap(first+left, first+l-1);
+    lo=l-1;
+    hi=lo+e;
+    for (long int i=0; i<e; i++)
+        first[l+i]=std::move(scratch[i]);
+    for (long int i=g+1, j=hi+1; j<=right; i++, j++)
+        first[j]=std::move(scratch[i]);
+}
+
+template<typename RandomIt, typename ScratchIt, typename Compare>
+void qs_extra_helper(RandomIt first, ScratchIt scratch, long int left, long int right,
+    int depth, Compare comp){
+    SortFrame<Compare> frame(comp);
+    while (right-left+1>leaf_cutoff<RandomIt, Compare>()){
+        if (depth==0){
+            SortTimer<Compare> timer(comp, SORT_PHASE_HEAP);
+            heap_sort_helper(first, left, right, comp);
+            return ;
+        }
+        depth--;
+        long int lo, hi;
+        {
+            SortTimer<Compare> timer(comp, SORT_PHASE_PARTITION);
+            partition(first, scratch, left, right, lo, hi, comp);
+        }
+        if (lo-left<right-hi){
+            qs_extra_helper(first, scratch, left, lo-1, depth, comp);
+            left=hi+1;
+        }
+        else{
+            qs_extra_helper(first, scratch, hi+1, right, depth, comp);
+            right=lo-1;
+        }
+    }
+    SortTimer<Compare> timer(comp, SORT_PHASE_LEAF);
+    leaf_sort_helper(first, left, right, comp);
+}
+
+template<typename RandomIt, typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+void quick_sort_extra(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    long int n=last-first;
+    if (n<2)
         return ;
-    pivotat=par(vector, left, right, comp);
-    qs_helper(vector, left, pivotat-1, par, comp);
-    qs_helper(vector, pivotat+1, right, par, comp);
+    //one buffer shared by every partition call
+    sort_allocation(comp, n*sizeof(T));
+    std::vector<T> scratch;
+    if constexpr (std::is_default_constructible<T>::value)
+        scratch.resize(n);
+    else{
+        //without a default constructor the slots are moved out of the range and back
+        scratch.assign(std::make_move_iterator(first), std::make_move_iterator(last));
+        std::move(scratch.begin(), scratch.end(), first);
+    }
+    qs_extra_helper(first, scratch.begin(), 0, n-1, introsort_depth(n), comp);
 }
 
-template<typename T, typename Compare>
-void quick_sort_extra(std::vector<T> &vector, Compare comp = std::less<T>()) {
-    qs_helper(vector,0,(long int)vector.size()-1, partition, comp);
+template<typename T, typename Compare = std::less<T>>
+void quick_sort_extra(std::vector<T> &vector, Compare comp = Compare()) {
+    quick_sort_extra(vector.begin(), vector.end(), comp);
 }
-template<typename T, typename Compare>
-void quick_sort_inplace(std::vector<T> &vector, Compare comp = std::less<T>()) {
-    qs_helper(vector,0,(long int)vector.size()-1, in_place_partition, comp);
+
+template<typename RandomIt, typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+void quick_sort_inplace(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    long int n=last-first;
+    if (n<2)
+        return ;
+    introsort_helper(first, 0, n-1, introsort_depth(n), comp);
+}
+
+template<typename T, typename Compare = std::less<T>>
+void quick_sort_inplace(std::vector<T> &vector, Compare comp = Compare()) {
+    quick_sort_inplace(vector.begin(), vector.end(), comp);
+}
+
+//stack space block_merge_sort merges short runs and blocks through
+const long int BLOCK_MERGE_CACHE_BYTES=4096;
+
+/**
+ * Stable merge of [lo, mid) and [mid, hi), where [lo, mid) has been moved
+ * out to cache beforehand
+ */
+template<typename RandomIt, typename T, typename Compare>
+void merge_from_cache(RandomIt first, T *cache, long int lo, long int mid, long int hi, Compare comp){
+    long int i=0, na=mid-lo, j=mid, k=lo;
+    while (i<na && j<hi){
+        if (comp(first[j],cache[i]))
+            first[k++]=std::move(first[j++]);
+        else
+            first[k++]=std::move(cache[i++]);
+    }
+    while (i<na)
+        first[k++]=std::move(cache[i++]);
+}
+
+/**
+ * Same, but [lo, mid) has been swapped with the internal buffer at
+ * buffer, and the merge swaps instead of moving, so the buffer's
+ * values end up back in it (in some order)
+ */
+template<typename RandomIt, typename Compare>
+void merge_from_buffer(RandomIt first, long int buffer, long int lo, long int mid, long int hi, Compare comp){
+    long int i=0, na=mid-lo, j=mid, k=lo;
+    if (na>0 && j<hi){
+        while (true){
+            if (!comp(first[j],first[buffer+i])){
+                std::iter_swap(first+k++, first+buffer+i++);
+                if (i==na)
+                    break;
+            }
+            else{
+                std::iter_swap(first+k++, first+j++);
+                if (j==hi)
+                    break;
+            }
+        }
+    }
+    std::swap_ranges(first+buffer+i, first+buffer+na, first+k);
+}
+
+/**
+ * Stable merge of [lo, mid) and [mid, hi) without any buffer: every
+ * group of equal elements of the left run is rotated into place.
+ * Time complexity: O(d (mid-lo) + hi-lo), d distinct values in [lo, mid)
+ */
+template<typename RandomIt, typename Compare>
+void merge_in_place(RandomIt first, long int lo, long int mid, long int hi, Compare comp){
+    while (lo<mid && mid<hi){
+        long int split=std::lower_bound(first+mid, first+hi, first[lo], comp)-first;
+        std::rotate(first+lo, first+mid, first+split);
+        lo+=split-mid;
+        mid=split;
+        lo=std::upper_bound(first+lo, first+mid, first[lo], comp)-first;
+    }
+}
+
+//number of distinct values in the sorted range [left, right), counting up to need
+template<typename RandomIt, typename Compare>
+long int count_distinct(RandomIt first, long int left, long int right, long int need, Compare comp){
+    long int count=0;
+    for (long int i=left; i<right && count<need; count++)
+        i=std::upper_bound(first+i, first+right, first[i], comp)-first;
+    return count;
+}
+
+/**
+ * Gather the first element of up to need distinct values of the sorted
+ * range [left, right) at its front, in order, keeping the rest sorted
+ * behind them.
+ * @return number of elements gathered
+ */
+template<typename RandomIt, typename Compare>
+long int pull_distinct(RandomIt first, long int left, long int right, long int need, Compare comp){
+    //the gathered values travel as one group, dropping the duplicates they pass behind them
+    long int start=left, end=left+1;
+    while (end-start<need){
+        long int next=std::upper_bound(first+end, first+right, first[end-1], comp)-first;
+        if (next==right)
+            break;
+        std::rotate(first+start, first+end, first+next);
+        start+=next-end;
+        end=next+1;
+    }
+    std::rotate(first+left, first+start, first+end);
+    return end-start;
+}
+
+/**
+ * Merge [lo, mid) and [mid, hi) by rolling the A blocks of block elements
+ * through the B blocks. The A blocks are tagged by swapping their first
+ * element with the sorted distinct values at tags, so the smallest one
+ * can still be found once the rolling has mixed them up. Whenever it is
+ * due, the smallest A block is dropped behind, and the block dropped
+ * before it is merged with the B elements in between: through cache if
+ * it fits there, through the internal buffer at buffer if there is one,
+ * by rotations otherwise.
+ */
+template<typename RandomIt, typename T, typename Compare>
+void block_merge(RandomIt first, long int lo, long int mid, long int hi, long int block, long int tags,
+    long int buffer, T *cache, long int cache_size, Compare comp){
+    auto stash=[&](long int from, long int size){
+        if (size<=cache_size)
+            std::move(first+from, first+from+size, cache);
+        else if (buffer>=0)
+            std::swap_ranges(first+from, first+from+size, first+buffer);
+    };
+    auto merge_back=[&](long int left, long int split, long int right){
+        if (split-left<=cache_size)
+            merge_from_cache(first, cache, left, split, right, comp);
+        else if (buffer>=0)
+            merge_from_buffer(first, buffer, left, split, right, comp);
+        else
+            merge_in_place(first, left, split, right, comp);
+    };
+
+    //the first A block takes the remainder, the others are full and tagged
+    long int first_a=lo+(mid-lo)%block;
+    for (long int t=tags, i=first_a; i<mid; i+=block)
+        std::iter_swap(first+t++, first+i);
+    long int last_a=lo, last_a_end=first_a, last_b=0, last_b_end=0;
+    long int a=first_a, a_end=mid, b=mid, b_end=mid+(block<hi-mid ? block : hi-mid);
+    long int tag=tags;
+    stash(last_a, last_a_end-last_a);
+    while (a<a_end){
+        if ((last_b<last_b_end && !comp(first[last_b_end-1],first[tag])) || b==b_end){
+            //the previous B block splits around the smallest A block
+            long int split=std::lower_bound(first+last_b, first+last_b_end, first[tag], comp)-first;
+            long int remaining=last_b_end-split;
+            long int smallest=a;
+            for (long int i=a+block; i<a_end; i+=block)
+                if (comp(first[i],first[smallest]))
+                    smallest=i;
+            if (smallest!=a)
+                std::swap_ranges(first+a, first+a+block, first+smallest);
+            std::iter_swap(first+a, first+tag++);
+
+            merge_back(last_a, last_a_end, split);
+            if (block<=cache_size || buffer>=0){
+                //the block's content is parked, so B's rest can be swapped over it instead of rotated
+                stash(a, block);
+                std::swap_ranges(first+split, first+a, first+a+block-remaining);
+            }
+            else
+                std::rotate(first+split, first+a, first+a+block);
+            last_a=a-remaining;
+            last_a_end=last_a+block;
+            last_b=last_a_end;
+            last_b_end=last_b+remaining;
+            a+=block;
+        }
+        else if (b_end-b<block){
+            //the short last B block goes in front of the A blocks
+            std::rotate(first+a, first+b, first+b_end);
+            last_b=a;
+            last_b_end=a+(b_end-b);
+            a+=b_end-b;
+            a_end+=b_end-b;
+            b_end=b;
+        }
+        else{
+            //roll the first A block behind the next B block
+            std::swap_ranges(first+a, first+a+block, first+b);
+            last_b=a;
+            last_b_end=a+block;
+            a+=block;
+            a_end+=block;
+            b+=block;
+            b_end=b_end+block<hi ? b_end+block : hi;
+        }
+    }
+    merge_back(last_a, last_a_end, hi);
+}
+
+/**
+ * One bottom-up level of block_merge_sort: merge [s, s+len) with
+ * [s+len, s+2len) for every s. The distinct values the block merges need
+ * are pulled out of one of the left runs first and put back afterwards.
+ */
+template<typename RandomIt, typename T, typename Compare>
+void block_merge_level(RandomIt first, long int n, long int len, T *cache, long int cache_size, Compare comp){
+    long int block=(long int)sqrt((double)len);
+    long int tags=len/block+1;
+    //blocks too big for the cache are merged through a second buffer of block values
+    long int need=tags+(block>cache_size ? block : 0);
+    long int home=0, count=0;
+    for (long int s=0; s+len<n && count<need; s+=2*len){
+        long int c=count_distinct(first, s, s+len, need, comp);
+        if (c>count){
+            home=s;
+            count=c;
+        }
+    }
+    count=pull_distinct(first, home, home+len, need, comp);
+    long int buffer=-1;
+    if (count==need && block>cache_size)
+        buffer=home+tags;
+    else if (count<tags)
+        block=len/count+1;
+
+    for (long int s=0; s+len<n; s+=2*len){
+        long int lo=s==home ? s+count : s, mid=s+len, hi=s+2*len<n ? s+2*len : n;
+        if (!comp(first[mid],first[mid-1]))
+            continue;
+        if (comp(first[hi-1],first[lo]))
+            std::rotate(first+lo, first+mid, first+hi);
+        else
+            block_merge(first, lo, mid, hi, block, home, buffer, cache, cache_size, comp);
+    }
+
+    //the values are distinct, so sorting them restores their order
+    long int home_end=home+2*len<n ? home+2*len : n;
+    quick_sort_inplace(first+home, first+home+count, comp);
+    merge_in_place(first, home, home+count, home_end, comp);
+}
+
+/**
+ * Stable in-place merge sort after WikiSort. Runs of MIN_RUN are sorted
+ * by extend_run and merged bottom up; while a run still fits into
+ * a fixed stack cache of BLOCK_MERGE_CACHE_BYTES it is merged through
+ * it, longer ones are block merged (see block_merge) with about sqrt(len)
+ * distinct values borrowed from the array as tags and buffer. With few
+ * distinct values the blocks grow and are merged by rotations instead.
+ * Needs no heap memory. T has to be default constructible.
+ * Time complexity: O(n log n), O(1) extra space
+ */
+template<typename RandomIt, typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+void block_merge_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    const long int cache_size=BLOCK_MERGE_CACHE_BYTES/(long int)sizeof(T)>0 ?
+        BLOCK_MERGE_CACHE_BYTES/(long int)sizeof(T) : 1;
+    long int n=last-first;
+    if (n<2)
+        return ;
+    {
+        SortTimer<Compare> timer(comp, SORT_PHASE_RUNS);
+        for (long int left=0; left<n; left+=MIN_RUN){
+            long int limit=left+MIN_RUN<n ? left+MIN_RUN : n;
+            extend_run(first, left, find_run(first, left, limit, comp), limit, comp);
+        }
+    }
+    SortTimer<Compare> timer(comp, SORT_PHASE_MERGE);
+    T cache[cache_size];
+    for (long int len=MIN_RUN; len<n; len*=2){
+        if (len>cache_size){
+            block_merge_level(first, n, len, cache, cache_size, comp);
+            continue;
+        }
+        for (long int s=0; s+len<n; s+=2*len){
+            long int mid=s+len, hi=s+2*len<n ? s+2*len : n;
+            //the left run's prefix that is not above the right run's head stays where it is
+            long int lo=std::upper_bound(first+s, first+mid, first[mid], comp)-first;
+            std::move(first+lo, first+mid, cache);
+            merge_from_cache(first, cache, lo, mid, hi, comp);
+        }
+    }
+}
+
+template<typename T, typename Compare = std::less<T>>
+void block_merge_sort(std::vector<T> &vector, Compare comp = Compare()) {
+    block_merge_sort(vector.begin(), vector.end(), comp);
+}
+
+/**
+ * Introselect: partition like introsort, but only keep the side that
+ * holds position k. Falls back to heapsort on the remaining range once
+ * the depth budget is spent.
+ * On return first[k] is the element a full sort would put there, with
+ * nothing greater before it and nothing less after it.
+ * Time complexity: O(n) expected, O(n log n) worst case
+ */
+template<typename RandomIt, typename Compare>
+void introselect_helper(RandomIt first, long int left, long int right, long int k, int depth, Compare comp){
+    while (right-left+1>leaf_cutoff<RandomIt, Compare>()){
+        if (depth==0){
+            SortTimer<Compare> timer(comp, SORT_PHASE_HEAP);
+            heap_sort_helper(first, left, right, comp);
+            return ;
+        }
+        depth--;
+        long int pivotat;
+        {
+            SortTimer<Compare> timer(comp, SORT_PHASE_PARTITION);
+            std::iter_swap(first+left, first+choose_pivot(first, left, right, comp));
+            pivotat=in_place_partition(first, left, right, comp);
+        }
+        if (pivotat==k)
+            return ;
+        if (k<pivotat)
+            right=pivotat-1;
+        else
+            left=pivotat+1;
+    }
+    SortTimer<Compare> timer(comp, SORT_PHASE_LEAF);
+    leaf_sort_helper(first, left, right, comp);
+}
+
+//the position is an index rather than an iterator, so calls never collide with std::nth_element
+template<typename RandomIt, typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+void nth_element(RandomIt first, RandomIt last, long int k, Compare comp = Compare()) {
+    long int n=last-first;
+    if (k<0 || k>=n)
+        return ;
+    introselect_helper(first, 0, n-1, k, introsort_depth(n), comp);
+}
+
+template<typename T, typename Compare = std::less<T>>
+void nth_element(std::vector<T> &vector, long int k, Compare comp = Compare()) {
+    nth_element(vector.begin(), vector.end(), k, comp);
+}
+
+/**
+ * Put the k smallest elements, sorted, in front; the rest are left in
+ * unspecified order behind them.
+ * Time complexity: O(n + k log k)
+ */
+template<typename RandomIt, typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+void partial_sort(RandomIt first, RandomIt last, long int k, Compare comp = Compare()) {
+    long int n=last-first;
+    if (k>n)
+        k=n;
+    if (k<=0)
+        return ;
+    if (k<n)
+        nth_element(first, last, k-1, comp);
+    quick_sort_inplace(first, first+k, comp);
+}
+
+template<typename T, typename Compare = std::less<T>>
+void partial_sort(std::vector<T> &vector, long int k, Compare comp = Compare()) {
+    partial_sort(vector.begin(), vector.end(), k, comp);
+}
+
+/**
+ * The k smallest elements of a single pass over [first, last), sorted.
+ * Keeps a bounded max-heap of the best k seen so far, so the input is
+ * never stored and may be any input iterator (a stream, a list, ...).
+ * Time complexity: O(n log k), O(k) extra space
+ */
+template<typename InputIt, typename Compare = std::less<typename std::iterator_traits<InputIt>::value_type>>
+std::vector<typename std::iterator_traits<InputIt>::value_type> top_k(InputIt first, InputIt last, long int k,
+    Compare comp = Compare()) {
+    std::vector<typename std::iterator_traits<InputIt>::value_type> heap;
+    if (k<=0)
+        return heap;
+    sort_allocation(comp, k*sizeof(typename std::iterator_traits<InputIt>::value_type));
+    heap.reserve(k);
+    for (; first!=last && (long int)heap.size()<k; ++first)
+        heap.push_back(*first);
+    long int size=(long int)heap.size();
+    for (long int i=size/2-1; i>=0; i--)
+        sift_down(heap.begin(), 0, i, size, comp);
+    //the root is the worst of the kept elements, anything better replaces it
+    for (; first!=last; ++first){
+        if (comp(*first, heap[0])){
+            heap[0]=*first;
+            sift_down(heap.begin(), 0, 0, size, comp);
+        }
+    }
+    for (long int end=size-1; end>0; end--){
+        std::iter_swap(heap.begin(), heap.begin()+end);
+        sift_down(heap.begin(), 0, 0, end, comp);
+    }
+    return heap;
+}
+
+template<typename T, typename Compare = std::less<T>>
+std::vector<T> top_k(const std::vector<T> &vector, long int k, Compare comp = Compare()) {
+    return top_k(vector.begin(), vector.end(), k, comp);
+}
+
+/**
+ * Map a numeric value to an unsigned integer that sorts the same way.
+ * Signed integers get their sign bit flipped; IEEE-754 floats are
+ * inverted entirely when negative and only in the sign bit otherwise.
+ * The mapping is one to one, radix_value undoes it.
+ */
+template<typename K>
+auto radix_bits(K key){
+    static_assert(std::is_arithmetic<K>::value && !std::is_same<K, bool>::value,
+        "radix_sort needs an integral or floating point key");
+    if constexpr (std::is_floating_point<K>::value){
+        typedef typename std::conditional<sizeof(K)==4, uint32_t, uint64_t>::type U;
+        static_assert(sizeof(K)==sizeof(U), "only float and double keys are supported");
+        U bits;
+        memcpy(&bits, &key, sizeof(K));
+        const U sign=U(1)<<(sizeof(U)*8-1);
+        return (bits&sign) ? U(~bits) : U(bits|sign);
+    }
+    else{
+        typedef typename std::make_unsigned<K>::type U;
+        U bits=(U)key;
+        if constexpr (std::is_signed<K>::value)
+            bits^=U(1)<<(sizeof(U)*8-1);
+        return bits;
+    }
+}
+
+template<typename K, typename U>
+K radix_value(U bits){
+    const U sign=U(1)<<(sizeof(U)*8-1);
+    if constexpr (std::is_floating_point<K>::value){
+        bits=(bits&sign) ? U(bits&~sign) : U(~bits);
+        K key;
+        memcpy(&key, &bits, sizeof(K));
+        return key;
+    }
+    else if constexpr (std::is_signed<K>::value)
+        return (K)(bits^sign);
+    else
+        return (K)bits;
+}
+
+/**
+ * radix_bits for sorting by key: -0 is mapped like +0, as the two compare
+ * equal and a stable sort has to keep them in their input order.
+ */
+template<typename K>
+auto radix_key(K key){
+    if constexpr (std::is_floating_point<K>::value)
+        if (key==0)
+            key=0;
+    return radix_bits(key);
+}
+
+//digit width of the LSD passes over bare values: 256 buckets keep the scatter within a few write streams
+const int RADIX_BITS=8;
+
+/**
+ * Stable LSD passes over keys[0, n), ping-ponging with tmp; a pass is
+ * skipped when every key has the same digit in it.
+ * @return keys or tmp, whichever holds the sorted keys
+ */
+template<typename U>
+U *radix_passes(U *keys, U *tmp, long unsigned int n){
+    const int PASSES=(sizeof(U)*8+RADIX_BITS-1)/RADIX_BITS;
+    const long unsigned int BUCKETS=1ul<<RADIX_BITS;
+    std::vector<long unsigned int> count(PASSES*BUCKETS, 0);
+    for (long unsigned int i=0; i<n; i++)
+        for (int p=0; p<PASSES; p++)
+            count[p*BUCKETS+((keys[i]>>(p*RADIX_BITS))&(BUCKETS-1))]++;
+    for (int p=0; p<PASSES; p++){
+        long unsigned int *c=&count[p*BUCKETS];
+        if (c[(keys[0]>>(p*RADIX_BITS))&(BUCKETS-1)]==n)
+            continue;
+        long unsigned int sum=0;
+        for (long unsigned int b=0; b<BUCKETS; b++){
+            long unsigned int t=c[b];
+            c[b]=sum;
+            sum+=t;
+        }
+        for (long unsigned int i=0; i<n; i++)
+            tmp[c[(keys[i]>>(p*RADIX_BITS))&(BUCKETS-1)]++]=keys[i];
+        std::swap(keys, tmp);
+    }
+    return keys;
+}
+
+/**
+ * LSD radix sort of numbers by their own value, ascending or descending.
+ * Only the radix_bits of the values are scattered, with no elements
+ * alongside, and turned back into values at the end.
+ * Time complexity: O(n * passes)
+ */
+template<typename RandomIt>
+void radix_sort_values(RandomIt first, RandomIt last, bool descending) {
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    typedef decltype(radix_bits(*first)) U;
+    long unsigned int n=last-first;
+    if (n<2)
+        return ;
+    //flipping every bit of the order-preserving pattern reverses the order
+    const U flip=descending ? U(~U(0)) : U(0);
+    std::vector<U> keys(n), tmp(n);
+    for (long unsigned int i=0; i<n; i++)
+        keys[i]=radix_bits(first[i])^flip;
+    U *sorted=radix_passes(keys.data(), tmp.data(), n);
+    for (long unsigned int i=0; i<n; i++)
+        first[i]=radix_value<T>(U(sorted[i]^flip));
+}
+
+/**
+ * Stable LSD radix sort on the numeric key key_fn(element).
+ * Keys are extracted once, then 11-bit digits (8-bit for keys narrower
+ * than 32 bits) are scattered pass by pass along with the elements; the
+ * wider digits save a pass of element moves. A pass is skipped when every
+ * key has the same digit in it. Without key_fn the elements are their own
+ * keys and go through radix_sort_values.
+ * Time complexity: O(n * passes)
+ */
+template<typename RandomIt, typename KeyFn>
+void radix_sort(RandomIt first, RandomIt last, KeyFn key_fn) {
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    typedef decltype(radix_key(key_fn(*first))) U;
+    const int BITS=sizeof(U)>=4 ? 11 : 8;
+    const int PASSES=(sizeof(U)*8+BITS-1)/BITS;
+    const long unsigned int BUCKETS=1ul<<BITS;
+    long unsigned int n=last-first;
+    if (n<2)
+        return ;
+
+    std::vector<U> keys(n);
+    std::vector<long unsigned int> count(PASSES*BUCKETS, 0);
+    for (long unsigned int i=0; i<n; i++){
+        keys[i]=radix_key(key_fn(first[i]));
+        for (int p=0; p<PASSES; p++)
+            count[p*BUCKETS+((keys[i]>>(p*BITS))&(BUCKETS-1))]++;
+    }
+
+    std::vector<U> keys2(n);
+    std::vector<T> buffer;
+    bool in_buffer=false;
+    for (int p=0; p<PASSES; p++){
+        long unsigned int *c=&count[p*BUCKETS];
+        if (c[(keys[0]>>(p*BITS))&(BUCKETS-1)]==n)
+            continue;
+        long unsigned int sum=0;
+        for (long unsigned int b=0; b<BUCKETS; b++){
+            long unsigned int t=c[b];
+            c[b]=sum;
+            sum+=t;
+        }
+        if (buffer.empty()){
+            //park the elements in the buffer and scatter them back from there
+            buffer.assign(std::make_move_iterator(first), std::make_move_iterator(last));
+            in_buffer=true;
+        }
+        for (long unsigned int i=0; i<n; i++){
+            long unsigned int pos=c[(keys[i]>>(p*BITS))&(BUCKETS-1)]++;
+            keys2[pos]=keys[i];
+            if (in_buffer)
+                first[pos]=std::move(buffer[i]);
+            else
+                buffer[pos]=std::move(first[i]);
+        }
+        keys.swap(keys2);
+        in_buffer=!in_buffer;
+    }
+    if (in_buffer)
+        std::move(buffer.begin(), buffer.end(), first);
+}
+
+template<typename T, typename KeyFn>
+void radix_sort(std::vector<T> &vector, KeyFn key_fn) {
+    radix_sort(vector.begin(), vector.end(), key_fn);
+}
+
+template<typename RandomIt>
+void radix_sort(RandomIt first, RandomIt last) {
+    radix_sort_values(first, last, false);
+}
+
+template<typename T>
+void radix_sort(std::vector<T> &vector) {
+    radix_sort(vector.begin(), vector.end());
+}
+
+template<typename RandomIt, typename U>
+void msd_helper(RandomIt first, std::vector<U> &keys, long int left, long int right, int shift){
+    //[left, right) all agree on the digits above shift
+    while (right-left>INSERTION_SORT_CUTOFF){
+        long int count[256]={0};
+        for (long int i=left; i<right; i++)
+            count[(keys[i]>>shift)&255]++;
+        long int next[256], end[256];
+        for (long int b=0, sum=left; b<256; b++){
+            next[b]=sum;
+            sum+=count[b];
+            end[b]=sum;
+        }
+        //American flag permutation: cycle each element into its bucket
+        for (long int b=0; b<256; b++){
+            while (next[b]<end[b]){
+                long int d=(keys[next[b]]>>shift)&255;
+                if (d==b)
+                    next[b]++;
+                else{
+                    long int to=next[d]++;
+                    std::swap(keys[next[b]], keys[to]);
+                    std::iter_swap(first+next[b], first+to);
+                }
+            }
+        }
+        if (shift==0)
+            return ;
+        //recurse into every bucket but the largest, which is looped on
+        long int big=0;
+        for (long int b=1; b<256; b++)
+            if (count[b]>count[big])
+                big=b;
+        for (long int b=0; b<256; b++)
+            if (b!=big && count[b]>1)
+                msd_helper(first, keys, end[b]-count[b], end[b], shift-8);
+        left=end[big]-count[big];
+        right=end[big];
+        shift-=8;
+    }
+    for (long int i=left+1; i<right; i++){
+        for (long int j=i; j>left && keys[j]<keys[j-1]; j--){
+            std::swap(keys[j], keys[j-1]);
+            std::iter_swap(first+j, first+j-1);
+        }
+    }
+}
+
+/**
+ * In-place MSD radix sort (American flag sort) on key_fn(element),
+ * 8 bits per level. Not stable, but needs no element buffer and moves
+ * every element about once per level, so it is meant for wide records
+ * with a numeric key (on 64-byte records it beats both radix_sort and
+ * the quicksorts); plain numbers sort faster with radix_sort.
+ * Time complexity: O(n * key bytes)
+ */
+template<typename RandomIt, typename KeyFn>
+void radix_sort_msd(RandomIt first, RandomIt last, KeyFn key_fn) {
+    typedef decltype(radix_key(key_fn(*first))) U;
+    long unsigned int n=last-first;
+    if (n<2)
+        return ;
+    std::vector<U> keys(n);
+    for (long unsigned int i=0; i<n; i++)
+        keys[i]=radix_key(key_fn(first[i]));
+    msd_helper(first, keys, 0, (long int)n, (int)sizeof(U)*8-8);
+}
+
+template<typename T, typename KeyFn>
+void radix_sort_msd(std::vector<T> &vector, KeyFn key_fn) {
+    radix_sort_msd(vector.begin(), vector.end(), key_fn);
+}
+
+template<typename RandomIt>
+void radix_sort_msd(RandomIt first, RandomIt last) {
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    radix_sort_msd(first, last, [](const T &x){ return x; });
+}
+
+template<typename T>
+void radix_sort_msd(std::vector<T> &vector) {
+    radix_sort_msd(vector.begin(), vector.end());
+}
+//probes sort_profile spends on each statistic
+const long int AUTO_SAMPLES=256;
+//a sampled "nearly sorted" verdict sends at most this many elements to
+//insertion sort, so a wrong estimate stays cheap
+const long int AUTO_NEARLY_SORTED_MAX=4096;
+
+/**
+ * Presortedness of a range, estimated from AUTO_SAMPLES probes:
+ * descents is the share of adjacent pairs that go down (exact for short
+ * ranges), inversions the share of random pairs that are out of order.
+ */
+struct SortProfile {
+    double descents;
+    double inversions;
+};
+
+template<typename RandomIt, typename Compare>
+SortProfile sort_profile(RandomIt first, long int n, Compare comp){
+    long int samples=n-1<AUTO_SAMPLES ? n-1 : AUTO_SAMPLES, descents=0, inversions=0;
+    unsigned long long seed=0x9E3779B97F4A7C15ull;
+    for (long int s=0; s<samples; s++){
+        seed=seed*6364136223846793005ull+1442695040888963407ull;
+        long int i=samples==n-1 ? s : (long int)((seed>>17)%(n-1));
+        descents+=comp(first[i+1], first[i]);
+        seed=seed*6364136223846793005ull+1442695040888963407ull;
+        long int j=(long int)((seed>>17)%n);
+        if (i<j)
+            inversions+=comp(first[j], first[i]);
+        else if (j<i)
+            inversions+=comp(first[i], first[j]);
+    }
+    SortProfile profile={(double)descents/samples, (double)inversions/samples};
+    return profile;
+}
+
+/**
+ * Number of runs merge_sort would find (non-descending or strictly
+ * descending), counting stops as soon as it exceeds limit.
+ * Time complexity: O(n), O(limit) on random data
+ */
+template<typename RandomIt, typename Compare>
+long int count_runs(RandomIt first, long int n, long int limit, Compare comp){
+    long int runs=0;
+    for (long int i=0; i<n && runs<=limit; runs++){
+        i++;
+        if (i<n && comp(first[i], first[i-1])){
+            while (i<n && comp(first[i], first[i-1]))
+                i++;
+        }
+        else{
+            while (i<n && !comp(first[i], first[i-1]))
+                i++;
+        }
+    }
+    return runs;
+}
+
+/**
+ * Pick an algorithm from the size, the presortedness, the element width
+ * and whether the key is numeric, using the crossovers measured by
+ * sort_calibrate.cpp (see sort_tuning.hpp):
+ * - tiny inputs, and small ones with few sampled inversions: insertion sort
+ * - at most n^(AUTO_MERGE_RUNS_EXPONENT/100) ascending or descending
+ *   runs: natural merge sort; a sample of descents rules out random data
+ *   before the runs are counted exactly
+ * - numbers under std::less or std::greater: radix sort, from a size
+ *   that depends on their width
+ * - everything else: introsort
+ * Not stable, since the choice depends on the data.
+ * Time complexity: O(n log n) worst case
+ */
+template<typename RandomIt, typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+void auto_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    long int n=last-first;
+    if (n<2)
+        return ;
+    if (n<=AUTO_INSERTION_MAX){
+        //network leaves beat insertion sort wherever they apply
+        if constexpr (use_network<RandomIt, Compare>())
+            quick_sort_inplace(first, last, comp);
+        else
+            insertion_sort(first, last, comp);
+        return ;
+    }
+
+    SortProfile profile=sort_profile(first, n, comp);
+    if (n<=AUTO_NEARLY_SORTED_MAX && profile.inversions*(n-1)/2<=AUTO_INSERTION_INVERSIONS){
+        insertion_sort(first, last, comp);
+        return ;
+    }
+    //every descent ends an ascending run and every ascent a descending one
+    double breaks=profile.descents<0.5 ? profile.descents : 1-profile.descents;
+    long int max_runs=(long int)pow((double)n, AUTO_MERGE_RUNS_EXPONENT/100.0);
+    if (breaks*AUTO_SAMPLES<=8 && count_runs(first, n, max_runs, comp)<=max_runs){
+        merge_sort(first, last, comp);
+        return ;
+    }
+    if constexpr (std::is_arithmetic<T>::value && !std::is_same<T, bool>::value
+        && network_order<T, Compare>::value!=0){
+        if (n>=(sizeof(T)<=4 ? AUTO_RADIX_MIN_NARROW : AUTO_RADIX_MIN_WIDE)){
+            radix_sort_values(first, last, network_order<T, Compare>::value<0);
+            return ;
+        }
+    }
+    quick_sort_inplace(first, last, comp);
+}
+
+template<typename T, typename Compare = std::less<T>>
+void auto_sort(std::vector<T> &vector, Compare comp = Compare()) {
+    auto_sort(vector.begin(), vector.end(), comp);
+}
+
+/**
+ * Rearrange [first, first+n) so that position i receives the element that
+ * was at from[i], following each cycle of the permutation with a single
+ * temporary. from is used to mark finished positions.
+ * Time complexity: O(n), one move per element plus one per cycle
+ */
+template<typename RandomIt>
+void apply_permutation(RandomIt first, std::vector<long int> &from){
+    long int n=(long int)from.size();
+    for (long int i=0; i<n; i++){
+        if (from[i]==i)
+            continue;
+        auto temp=std::move(first[i]);
+        long int j=i;
+        while (from[j]!=i){
+            long int next=from[j];
+            first[j]=std::move(first[next]);
+            from[j]=j;
+            j=next;
+        }
+        first[j]=std::move(temp);
+        from[j]=j;
+    }
+}
+
+/**
+ * Stable sort by a cached key (decorate-sort-undecorate).
+ * key_fn is called once per element to build a contiguous array of
+ * (key, position) pairs; only that array is sorted and the elements are
+ * then moved once into their final place. Meant for elements whose
+ * comparison is expensive, e.g. pointers to scattered objects.
+ * Numeric keys under std::less or std::greater go through the radix
+ * sort once there are enough of them, anything else through auto_sort
+ * with the position as the tie-break. Elements no larger than a cached
+ * entry are gathered through a buffer, bigger ones are permuted in place
+ * cycle by cycle.
+ * Time complexity: O(n) for numeric keys, O(n log n) otherwise
+ */
+template<typename RandomIt, typename KeyFn, typename Compare>
+void sort_by_key(RandomIt first, RandomIt last, KeyFn key_fn, Compare comp) {
+    typedef typename std::decay<decltype(key_fn(*first))>::type K;
+    typedef std::pair<K, long int> Entry;
+    long int n=last-first;
+    if (n<2)
+        return ;
+    std::vector<Entry> entries;
+    sort_allocation(comp, n*sizeof(Entry));
+    entries.reserve(n);
+    for (long int i=0; i<n; i++)
+        entries.emplace_back(key_fn(first[i]), i);
+
+    bool sorted=false;
+    if constexpr (std::is_arithmetic<K>::value && !std::is_same<K, bool>::value
+        && network_order<K, Compare>::value!=0){
+        if (n>=(sizeof(K)<=4 ? AUTO_RADIX_MIN_NARROW : AUTO_RADIX_MIN_WIDE)){
+            //flipping every bit of the order-preserving pattern reverses the order
+            if (network_order<K, Compare>::value>0)
+                radix_sort(entries, [](const Entry &e){ return radix_key(e.first); });
+            else
+                radix_sort(entries, [](const Entry &e){ return decltype(radix_key(e.first))(~radix_key(e.first)); });
+            sorted=true;
+        }
+    }
+    if (!sorted)
+        auto_sort(entries, [&comp](const Entry &a, const Entry &b){
+            if (comp(a.first, b.first))
+                return true;
+            return !comp(b.first, a.first) && a.second<b.second;
+        });
+
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    if constexpr (sizeof(T)<=sizeof(Entry)){
+        //small elements: gather into a buffer, the independent loads are
+        //far faster than chasing cycles and the buffer is no bigger than entries
+        std::vector<T> buffer;
+        buffer.reserve(n);
+        for (long int i=0; i<n; i++)
+            buffer.push_back(std::move(first[entries[i].second]));
+        std::move(buffer.begin(), buffer.end(), first);
+    }
+    else{
+        std::vector<long int> from(n);
+        for (long int i=0; i<n; i++)
+            from[i]=entries[i].second;
+        entries.clear();
+        entries.shrink_to_fit();
+        apply_permutation(first, from);
+    }
+}
+
+template<typename RandomIt, typename KeyFn>
+void sort_by_key(RandomIt first, RandomIt last, KeyFn key_fn) {
+    typedef typename std::decay<decltype(key_fn(*first))>::type K;
+    sort_by_key(first, last, key_fn, std::less<K>());
+}
+
+template<typename T, typename KeyFn, typename Compare>
+void sort_by_key(std::vector<T> &vector, KeyFn key_fn, Compare comp) {
+    sort_by_key(vector.begin(), vector.end(), key_fn, comp);
+}
+
+template<typename T, typename KeyFn>
+void sort_by_key(std::vector<T> &vector, KeyFn key_fn) {
+    sort_by_key(vector.begin(), vector.end(), key_fn);
 }
 
 #endif //VE281P1_SORT_HPP
\ No newline at end of file
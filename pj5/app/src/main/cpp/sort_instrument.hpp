@@ -0,0 +1,188 @@
+#ifndef VE281P1_SORT_INSTRUMENT_HPP
+#define VE281P1_SORT_INSTRUMENT_HPP
+
+#include "sort_network.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <utility>
+
+/**
+ * Opt-in instrumentation for the algorithms in sort.hpp.
+ * Wrapping the comparator with instrument(comp, stats) counts comparisons,
+ * buffer allocations, recursion depth, heapsort fallbacks and the time
+ * spent per phase; wrapping the elements in Counted<T> counts their moves
+ * and copies. The algorithms call the hooks below unconditionally, but
+ * for any other comparator they are empty inline functions and classes,
+ * so an uninstrumented sort compiles to the same code as before.
+ * An instrumented comparator keeps the network and radix fast paths of the
+ * comparator it wraps, so it observes the production code path; the
+ * branch-free network leaves do not report their comparisons.
+ */
+
+enum SortPhase {
+    SORT_PHASE_RUNS,        //finding and extending natural runs
+    SORT_PHASE_MERGE,       //merging runs
+    SORT_PHASE_PARTITION,   //quicksort and quickselect partitioning
+    SORT_PHASE_LEAF,        //insertion sort or network on short ranges
+    SORT_PHASE_HEAP,        //heapsort once the introsort depth budget ran out
+    SORT_PHASES
+};
+
+static const char *const SORT_PHASE_NAMES[SORT_PHASES]={"runs", "merge", "partition", "leaf", "heap"};
+
+/**
+ * Counters filled by an instrumented sort. All of them are atomic, so a
+ * single SortStats can be shared by the threads of a parallel sort; phase
+ * times are then summed over the threads.
+ */
+struct SortStats {
+    std::atomic<long int> comparisons, moves, copies, allocations, allocated_bytes, max_depth;
+    std::atomic<long int> phase_calls[SORT_PHASES], phase_ns[SORT_PHASES];
+
+    SortStats() { reset(); }
+
+    void reset() {
+        comparisons=0;
+        moves=0;
+        copies=0;
+        allocations=0;
+        allocated_bytes=0;
+        max_depth=0;
+        for (int p=0; p<SORT_PHASES; p++){
+            phase_calls[p]=0;
+            phase_ns[p]=0;
+        }
+    }
+
+    void print(FILE *out = stderr) const {
+        fprintf(out, "comparisons %ld\nmoves %ld\ncopies %ld\nallocations %ld (%ld bytes)\nmax depth %ld\n",
+            comparisons.load(), moves.load(), copies.load(), allocations.load(), allocated_bytes.load(),
+            max_depth.load());
+        for (int p=0; p<SORT_PHASES; p++)
+            if (phase_calls[p].load()>0)
+                fprintf(out, "%s: %ld calls, %.3f ms\n", SORT_PHASE_NAMES[p], phase_calls[p].load(),
+                    phase_ns[p].load()/1e6);
+    }
+};
+
+/**
+ * Comparator wrapper that counts every call into stats
+ */
+template<typename Compare>
+struct Instrumented {
+    Compare comp;
+    SortStats *stats;
+
+    template<typename A, typename B>
+    bool operator()(const A &a, const B &b) const {
+        stats->comparisons.fetch_add(1, std::memory_order_relaxed);
+        return comp(a, b);
+    }
+};
+
+template<typename Compare>
+Instrumented<Compare> instrument(Compare comp, SortStats &stats) {
+    return Instrumented<Compare>{comp, &stats};
+}
+
+//an instrumented std::less or std::greater still selects the network and radix paths
+template<typename T, typename Compare>
+struct network_order<T, Instrumented<Compare>> : network_order<T, Compare> {};
+
+/**
+ * Element wrapper that counts moves and copies into Counted<T>::stats.
+ * It converts to const T&, so comparators written for T keep working,
+ * but the type-based fast paths (networks, radix) no longer apply.
+ */
+template<typename T>
+struct Counted {
+    T value;
+    static inline SortStats *stats=nullptr;
+
+    Counted() : value() {}
+    Counted(const T &value) : value(value) {}
+    Counted(const Counted &other) : value(other.value) { count(stats ? &stats->copies : nullptr); }
+    Counted(Counted &&other) : value(std::move(other.value)) { count(stats ? &stats->moves : nullptr); }
+
+    Counted &operator=(const Counted &other) {
+        value=other.value;
+        count(stats ? &stats->copies : nullptr);
+        return *this;
+    }
+
+    Counted &operator=(Counted &&other) {
+        value=std::move(other.value);
+        count(stats ? &stats->moves : nullptr);
+        return *this;
+    }
+
+    operator const T &() const { return value; }
+
+    bool operator<(const Counted &other) const { return value<other.value; }
+
+private:
+    static void count(std::atomic<long int> *counter) {
+        if (counter)
+            counter->fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+//hooks called by the algorithms; no-ops unless Compare is Instrumented
+
+template<typename Compare>
+inline void sort_allocation(const Compare &, long int) {}
+
+template<typename Compare>
+inline void sort_allocation(const Instrumented<Compare> &comp, long int bytes) {
+    comp.stats->allocations.fetch_add(1, std::memory_order_relaxed);
+    comp.stats->allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+/**
+ * Scope of one recursive call, tracks the deepest nesting seen
+ */
+template<typename Compare>
+struct SortFrame {
+    explicit SortFrame(const Compare &) {}
+};
+
+template<typename Compare>
+struct SortFrame<Instrumented<Compare>> {
+    static inline thread_local long int depth=0;
+
+    explicit SortFrame(const Instrumented<Compare> &comp) {
+        long int d=++depth, seen=comp.stats->max_depth.load();
+        while (d>seen && !comp.stats->max_depth.compare_exchange_weak(seen, d))
+            ;
+    }
+
+    ~SortFrame() { depth--; }
+};
+
+/**
+ * Scope that adds its wall-clock time to one phase
+ */
+template<typename Compare>
+struct SortTimer {
+    SortTimer(const Compare &, SortPhase) {}
+};
+
+template<typename Compare>
+struct SortTimer<Instrumented<Compare>> {
+    SortStats *stats;
+    SortPhase phase;
+    std::chrono::steady_clock::time_point start;
+
+    SortTimer(const Instrumented<Compare> &comp, SortPhase phase)
+        : stats(comp.stats), phase(phase), start(std::chrono::steady_clock::now()) {}
+
+    ~SortTimer() {
+        std::chrono::nanoseconds took=std::chrono::steady_clock::now()-start;
+        stats->phase_calls[phase].fetch_add(1, std::memory_order_relaxed);
+        stats->phase_ns[phase].fetch_add((long int)took.count(), std::memory_order_relaxed);
+    }
+};
+
+#endif //VE281P1_SORT_INSTRUMENT_HPP
@@ -86,6 +86,18 @@ public class ShopManager {
      */
     public native void orderByRating();
 
+    /**
+     * move the k cheapest shops to the front, ordered by price,
+     * cheaper than orderByPrice when only the first page is shown
+     */
+    public native void orderTopByPrice(int k);
+
+    /**
+     * move the k best rated shops to the front, ordered by rating,
+     * cheaper than orderByRating when only the first page is shown
+     */
+    public native void orderTopByRating(int k);
+
     /**
      * find shop nearby the given location
      */